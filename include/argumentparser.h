@@ -2,6 +2,7 @@
 #define ARGUMENTPARSER_H
 
 #include <QObject>
+#include <QStringList>
 
 class ArgumentParser : public QObject
 {
@@ -13,26 +14,53 @@ public:
         : QObject(parent)
         , m_isSystemTray(false)
         , m_isShowMinimized(false)
-        , m_filePath() {}
+        , m_filePath()
+        , m_exportPngPath()
+        , m_exportSvgPath()
+        , m_convertFormat()
+        , m_batchPath()
+        , m_dpi(96)
+        , m_jobs(0) {}
 
     /** parse QCoreApplication::arguments and put data to priv. members
       * @return true if the program can continue
       */
     bool parseCmdLineArgs();
 
+    // the same on the arguments without the program name
+    bool parseArgs(QStringList cmdlineArgs);
+
     bool isSystemTray();
     bool isShowMinimized();
     QString filePath();
 
+    // headless mode: load, export/convert and exit without a window
+    bool isHeadless();
+    QString exportPngPath();
+    QString exportSvgPath();
+    QString convertFormat();    // "qmm" or "qmmb"
+    QString batchPath();
+    int dpi();
+    int jobs();                 // parallel batch jobs, 0: one per core
+
 
 private:
 
     // print --help text
     void printUsage();
 
+    // takes the options with a value out of the arguments
+    bool parseValueOptions(QStringList &cmdlineArgs);
+
     bool m_isSystemTray;
     bool m_isShowMinimized;
     QString m_filePath;
+    QString m_exportPngPath;
+    QString m_exportSvgPath;
+    QString m_convertFormat;
+    QString m_batchPath;
+    int m_dpi;
+    int m_jobs;
 };
 
 #endif // ARGUMENTPARSER_H
@@ -0,0 +1,48 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <QObject>
+#include <QEventLoop>
+#include <QHash>
+#include <QProcess>
+#include <QStringList>
+
+#include "argumentparser.h"
+
+/** Runs the command line jobs without a window: loads a map, exports
+  * and converts it. The lines of a batch list run as separate qtmindmap
+  * processes, several at once: a scene can be used only from the GUI
+  * thread, so processes are the way to use all the cores.
+  */
+class BatchRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit BatchRunner(QObject *parent = 0);
+
+    // @return exit code of the program
+    int run(ArgumentParser &arguments);
+
+private slots:
+
+    void printNotification(const QString &msg);
+    void jobFinished(int exitCode, QProcess::ExitStatus exitStatus);
+
+private:
+
+    int runJob(ArgumentParser &arguments);
+    int runBatch(const QString &listPath, const int &jobs);
+    bool startNextJob();
+
+    // arguments of a line, "quoted" ones may contain spaces
+    static QStringList splitLine(const QString &line);
+
+    QList<QStringList> m_pendingJobs;
+    QHash<QProcess *, QStringList> m_runningJobs;
+    int m_failedJobs;
+    QEventLoop m_loop;
+};
+
+#endif // BATCHRUNNER_H
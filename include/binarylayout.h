@@ -0,0 +1,69 @@
+#ifndef BINARYLAYOUT_H
+#define BINARYLAYOUT_H
+
+#include <QtGlobal>
+
+/** Layout of the .qmmb binary map file. All numbers are little endian,
+  * reals are IEEE 754 doubles.
+  *
+  * header (32 bytes):
+  *   "QMMB", version, node count, edge count,
+  *   heap offset, heap size, node table offset, edge table offset
+  * string heap:
+  *   the content of the nodes as UTF-16
+  * node table (48 bytes per node):
+  *   id, color, text color, content offset in the heap (bytes),
+  *   content length (UTF-16 units), content type, x, y, scale
+  * edge table (24 bytes per edge):
+  *   source id, destination id, color, flags (bit 0: secondary), width
+  *
+  * The heap precedes the tables, so a writer can stream the contents and
+  * keep only the fixed-width records in memory until the end.
+  */
+namespace BinaryLayout
+{
+    static const char magic[4] = { 'Q', 'M', 'M', 'B' };
+    static const quint32 version = 1;
+
+    static const int headerSize = 32;
+    static const int nodeRecordSize = 48;
+    static const int edgeRecordSize = 24;
+
+    enum HeaderField
+    {
+        MagicOffset = 0,
+        VersionOffset = 4,
+        NodeCountOffset = 8,
+        EdgeCountOffset = 12,
+        HeapOffsetOffset = 16,
+        HeapSizeOffset = 20,
+        NodeTableOffsetOffset = 24,
+        EdgeTableOffsetOffset = 28
+    };
+
+    enum NodeField
+    {
+        NodeIdOffset = 0,
+        NodeColorOffset = 4,
+        NodeTextColorOffset = 8,
+        NodeContentOffset = 12,
+        NodeContentLengthOffset = 16,
+        NodeContentTypeOffset = 20,     // 0 (HtmlDocument) in old files
+        NodeXOffset = 24,
+        NodeYOffset = 32,
+        NodeScaleOffset = 40
+    };
+
+    enum EdgeField
+    {
+        EdgeSourceOffset = 0,
+        EdgeDestinationOffset = 4,
+        EdgeColorOffset = 8,
+        EdgeFlagsOffset = 12,
+        EdgeWidthOffset = 16
+    };
+
+    static const quint32 secondaryFlag = 0x1;
+}
+
+#endif // BINARYLAYOUT_H
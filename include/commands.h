@@ -2,6 +2,7 @@
 #define COMMANDS_H
 
 #include <QUndoCommand>
+#include <QDataStream>
 #include <exception>
 
 #include "graphlogic.h"
@@ -66,8 +67,16 @@ public:
 
     BaseUndoClass(UndoContext context);
 
+    // on the given Nodes, context.m_subtree tells if they are a subtree
+    BaseUndoClass(UndoContext context, const QList<Node *> &nodeList);
+
+    // append the change as a Journal record
+    virtual void writeJournal(QDataStream &stream) const = 0;
+
 protected:
 
+    QList<qint32> nodeIds() const;
+
     bool m_done;
     UndoContext m_context;
     Node *m_activeNode;
@@ -86,11 +95,13 @@ public:
 
     void undo();
     void redo();
+    void writeJournal(QDataStream &stream) const;
 
 private:
 
     Node *m_node;
     Edge *m_edge;
+    qreal m_width;
 };
 
 class RemoveNodeCommand : public BaseUndoClass
@@ -102,6 +113,7 @@ public:
 
     void undo();
     void redo();
+    void writeJournal(QDataStream &stream) const;
 
 private:
 
@@ -119,10 +131,12 @@ public:
 
     void undo();
     void redo();
+    void writeJournal(QDataStream &stream) const;
 
 private:
 
     Edge *m_edge;
+    qreal m_width;
 };
 
 class RemoveEdgeCommand : public BaseUndoClass
@@ -134,6 +148,7 @@ public:
 
     void undo();
     void redo();
+    void writeJournal(QDataStream &stream) const;
 
 private:
 
@@ -147,11 +162,22 @@ public:
 
     MoveCommand(UndoContext context);
 
+    // a finished mouse drag: the Nodes are at their new place already,
+    // the first redo() does not move them and it is not merged
+    MoveCommand(UndoContext context, const QList<Node *> &nodeList);
+
     void undo();
     void redo();
+    void writeJournal(QDataStream &stream) const;
 
     bool mergeWith(const QUndoCommand *command);
     int id() const;
+
+private:
+
+    void setMoveText();
+
+    bool m_gesture;
 };
 
 class NodeColorCommand : public BaseUndoClass
@@ -163,6 +189,7 @@ public:
 
     void undo();
     void redo();
+    void writeJournal(QDataStream &stream) const;
 
 private:
 
@@ -178,6 +205,7 @@ public:
 
     void undo();
     void redo();
+    void writeJournal(QDataStream &stream) const;
 
 private:
 
@@ -193,6 +221,7 @@ public:
 
     void undo();
     void redo();
+    void writeJournal(QDataStream &stream) const;
 
     bool mergeWith(const QUndoCommand *command);
     int id() const;
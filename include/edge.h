@@ -2,6 +2,8 @@
 #define EDGE_H
 
 #include <QGraphicsItem>
+#include <QPen>
+#include <QPolygonF>
 
 class Node;
 
@@ -29,15 +31,36 @@ public:
     // called when the source/dest node changed (size,pos)
     void adjust();
 
-protected:
+    // adjust() once at the end of the event loop turn or before the next
+    // paint, however many times it is asked meanwhile, see GraphLogic
+    void adjustLater();
+    bool adjustPending() const;
+    void setAdjustPending(const bool &pending);
 
+    // what adjust() calculated, for paint() and EdgeLayer
     QRectF boundingRect() const;
+    QLineF line() const;
+    const QPolygonF &arrow() const;     // empty if the nodes are too close
+    const QPen &linePen() const;
+    const QPen &arrowPen() const;
+    bool overlaps() const;              // the end nodes overlap, no line
+
+protected:
+
+    QVariant itemChange(GraphicsItemChange change, const QVariant &value);
     void paint(QPainter *painter,
                const QStyleOptionGraphicsItem *option,
                QWidget *widget);
 
 private:
 
+    // caches of paint(), after the end points or the look changed
+    void updateGeometry();
+    void updatePens();
+
+    // repaints the Edge on the EdgeLayer of the scene if there is one
+    void updateLayer();
+
     Node *m_sourceNode;
     Node *m_destNode;
 
@@ -46,6 +69,14 @@ private:
     double m_angle;
     QColor m_color;
     qreal m_width;
+    bool m_adjustPending;
+
+    // calculated by adjust()
+    bool m_overlap;
+    QPolygonF m_arrow;      // empty if the nodes are too close
+    QRectF m_boundingRect;
+    QPen m_linePen;
+    QPen m_arrowPen;
 
     // just a logical connection between two nodes,
     // does not counts at subtree calculation
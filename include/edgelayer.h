@@ -0,0 +1,69 @@
+#ifndef EDGELAYER_H
+#define EDGELAYER_H
+
+#include <QGraphicsObject>
+#include <QHash>
+#include <QList>
+#include <QSet>
+
+class Edge;
+
+/** One item drawing all the Edges of the scene, the Edges themselves have
+  * no contents while it is on. The Edges are in a grid of m_cellSize
+  * cells by their bounding rects: a changed Edge repaints its old and new
+  * rect only, and paint() takes the Edges of the cells of the exposed rect.
+  * An Edge whose rect covers more than m_maxEdgeCells cells is kept in a
+  * list of its own instead, the long ones would fill the cells of a large
+  * area with nothing in most of them.
+  * They are drawn in one drawLines() and one drawPath() for the arrows
+  * per look (color, width, line style).
+  */
+class EdgeLayer : public QGraphicsObject
+{
+public:
+
+    EdgeLayer();
+
+    // the geometry is taken from Edge::boundingRect(), so after adjust()
+    void insertEdge(Edge *edge);
+    void removeEdge(Edge *edge);
+
+    // the geometry or the look of an inserted Edge has changed
+    void updateEdge(Edge *edge);
+    void clear();
+
+    bool contains(Edge *edge) const;
+    int edgeCount() const;
+
+    // the Edges whose bounding rect intersects rect
+    QList<Edge *> edgesIn(const QRectF &rect) const;
+
+    QRectF boundingRect() const;
+    void paint(QPainter *painter,
+               const QStyleOptionGraphicsItem *option,
+               QWidget *widget);
+
+private:
+
+    // the range of the cells rect is on, in cell coordinates
+    QRect cellsOf(const QRectF &rect) const;
+    static bool isOversized(const QRect &cells);
+    void insertIntoCells(Edge *edge, const QRect &cells);
+    void removeFromCells(Edge *edge, const QRect &cells);
+
+    static qint64 cellKey(const int &x, const int &y);
+    static bool lessByLook(const Edge *a, const Edge *b);
+    static bool sameLook(const Edge *a, const Edge *b);
+
+    QHash<qint64, QList<Edge *> > m_cells;
+    QSet<Edge *> m_oversizedEdges;          // in no cell
+    QHash<Edge *, QRectF> m_rectOfEdge;     // as it is in the cells
+
+    // grown by the inserts, reset by clear()
+    QRectF m_boundingRect;
+
+    static const qreal m_cellSize;
+    static const int m_maxEdgeCells;
+};
+
+#endif // EDGELAYER_H
@@ -2,11 +2,21 @@
 #define GRAPHLOGIC_H
 
 #include <QObject>
+#include <QHash>
+#include <QPointer>
 #include <QUndoStack>
+#include <QFutureWatcher>
+#include <QTimer>
+#include <QVector>
 
 #include "node.h"
 #include "graphwidget.h"
 #include "commands.h"
+#include "mapdata.h"
+#include "subtreeindex.h"
+#include "edgelayer.h"
+#include "nodeshadow.h"
+#include "journal.h"
 
 
 class GraphWidget;
@@ -23,6 +33,7 @@ class GraphLogic : public QObject
 public:
 
     explicit GraphLogic(GraphWidget *parent = 0);
+    ~GraphLogic();
     GraphWidget *graphWidget() const;
     void setUndoStack(QUndoStack *stack);
 
@@ -30,9 +41,31 @@ public:
     void addFirstNode();
     void removeAllNodes();
 
-    bool readContentFromXmlFile(const QString &fileName);
-    void writeContentToXmlFile(const QString &fileName);
-    void writeContentToPngFile(const QString &fileName);
+    // .qmm and .qmmb files
+    bool readContentFromFile(const QString &fileName);
+
+    // parses the file on a worker thread and adds the nodes to the scene
+    // in short batches from the event loop, the base node and the levels
+    // near it first; loadProgress() and loadFinished() report it
+    void readContentInBackground(const QString &fileName);
+    bool isLoading() const;
+    void writeContentToFile(const QString &fileName);
+
+    // copies the map and writes the copy on a worker thread, saves
+    // requested meanwhile are merged into one that follows it
+    void writeContentInBackground(const QString &fileName);
+    bool isSaving() const;
+
+    // append the changes to the journal of the map if journal mode is on
+    // and the journal can be used, write the whole map otherwise
+    void writeChangesToFile(const QString &fileName);
+
+    // a scene unit is a pixel at m_sceneDpi, the memory use is bounded
+    // by m_exportBandMemory whatever the size of the image is
+    bool writeContentToPngFile(const QString &fileName, const int &dpi = 96);
+
+    // vector image of the same area as the PNG image
+    bool writeContentToSvgFile(const QString &fileName);
 
     Node *nodeFactory();
     void setActiveNode(Node *node);
@@ -41,8 +74,56 @@ public:
 
     void moveNode(qreal x, qreal y); // undo command
 
+    // mouse drag of the active Node: the moved Nodes are collected at the
+    // press and moved directly, the release pushes one undo command
+    void beginDrag(Node *node, const bool &subtree);
+    void drag(const qreal &x, const qreal &y);
+    void endDrag();
+    bool isDragging() const;
+
+    // the scene items report here when they enter and leave the scene
+    void nodeAddedToScene(Node *node);
+    void nodeRemovedFromScene(Node *node);
+    void edgeAddedToScene(Edge *edge);
+    void edgeRemovedFromScene(Edge *edge);
+
+    // the subtrees of the Nodes in the scene
+    SubtreeIndex *subtreeIndex();
+
+    // bounds of the Nodes, grown by each move, scaling and edit; the
+    // canvas of the GraphWidget follows it
+    void nodeGeometryChanged(Node *node);
+    QRectF contentRect() const;
+
+    // the shadow follows the Node with the border, see Node::setBorder()
+    void nodeBorderChanged(Node *node, const bool &hasBorder);
+    NodeShadow *nodeShadow() const;
+
+    // 0 if the Edges draw themselves, see setEdgeLayer()
+    EdgeLayer *edgeLayer() const;
+
+    // deferred Edge::adjust(), an Edge is queued once however many of its
+    // moves, scalings and edits are asked in an event loop turn
+    void scheduleAdjust(Edge *edge);
+    void cancelAdjust(Edge *edge);
+    quint64 adjustRequests() const;
+    quint64 adjustRuns() const;
+
+    // the scene index: a BSP tree from m_bspIndexItems items on, none while
+    // a map is loaded or a big subtree is dragged, the tree is rebuilt
+    // after them; it only switches if the policy asks an other method
+    void updateItemIndex();
+
 public slots:
 
+    void setJournalMode(const bool &journalMode = true);
+
+    // all the Edges drawn by one EdgeLayer item instead of their own
+    // paint(), for maps with many Edges; see updateEdgeLayer()
+    void setEdgeLayer(const bool &enabled = true);
+    void cancelLoading();
+    void flushAdjusts();
+
     // commands from toolbars:
     void insertNode();      // undo command
     void removeNode();      // undo command
@@ -61,13 +142,45 @@ public slots:
     void nodeMoved(QGraphicsSceneMouseEvent *event);
     void nodeLostFocus();
 
+private slots:
+
+    void backgroundSaveFinished();
+    void loadPrepared();
+    void loadBatch();
+
 signals:
 
     void contentChanged(const bool& changed = true);
     void  notification(const QString &msg);
+    void loadProgress(const int &done, const int &total);
+    void loadFinished(const bool &success);
 
 private:
 
+    // the read map in the order its parts are added to the scene, in
+    // chunks of m_loadChunkSize which are freed when they are added
+    struct LoadingMap
+    {
+        QList<QVector<NodeData> > m_nodeChunks;    // by level
+        QList<QVector<EdgeData> > m_edgeChunks;
+        QVector<int> m_edgeReady;   // position of the later end node
+        int m_nodeCount;
+        int m_edgeCount;
+
+        // laid out contents of the nodes in their order, empty if fonts
+        // can't be used outside the GUI thread; set to 0 when given to a
+        // Node
+        QList<QTextDocument *> m_documents;
+        int m_maxId;
+        QString m_error;
+        QString m_journalError;
+    };
+
+    // runs on a worker thread
+    static LoadingMap prepareMap(const QString &fileName);
+    static QTextDocument *layoutDocument(const NodeData &data);
+    void finishLoading();
+
     void moveNodeUp();
     void moveNodeDown();
     void moveNodeLeft();
@@ -80,6 +193,30 @@ private:
 
     void selectNode(Node *node);
 
+    // conversion between the scene and the file records
+    Node *createNode(const NodeData &data, QTextDocument *document = 0);
+    Edge *createEdge(const EdgeData &data, Node *source, Node *destination);
+    NodeData nodeData(Node *node) const;
+    EdgeData edgeData(Edge *edge) const;
+
+    // the exported area: the bounds of the Nodes now and m_exportMargin
+    // around them, the canvas is larger as it never shrinks
+    QRectF exportRect() const;
+
+    MapData snapshot() const;
+
+    // the journal is part of the written map from now on
+    void savedSnapshot(const QString &fileName);
+
+    // apply the journal of the map file on the loaded Nodes
+    bool replayJournal(const Journal &journal, QHash<int, Node *> &nodes);
+    bool replayJournalRecord(const quint8 &type,
+                             QDataStream &stream,
+                             QHash<int, Node *> &nodes);
+
+    // the same on the read map, before any Node of it is created
+    static bool replayJournal(const Journal &journal, MapData *map);
+
     // functions on the edges
     QList<Edge *> allEdges() const;
     void addEdge(Node *source, Node *destination);      // undo command
@@ -94,6 +231,13 @@ private:
     GraphWidget *m_graphWidget;
 
     QList<Node *> m_nodeList;
+    int m_sceneNodeCount;
+    int m_sceneEdgeCount;
+    SubtreeIndex m_subtreeIndex;
+    QRectF m_contentRect;
+    QPointer<EdgeLayer> m_edgeLayer;     // the scene deletes it at the end
+    QPointer<NodeShadow> m_nodeShadow;   // the same, once it is in a scene
+    int m_nextNodeId;
     Node *m_activeNode;
     bool m_showingNodeNumbers;
     QString m_hintNumber;
@@ -104,6 +248,65 @@ private:
 
     std::map<int, void(GraphLogic::*)(void)> m_memberMap;
     QUndoStack *m_undoStack;
+
+    // edges waiting for adjust()
+    QList<Edge *> m_adjustEdges;
+    QTimer m_adjustTimer;
+    quint64 m_adjustRequests;
+    quint64 m_adjustRuns;
+
+    // mouse drag
+    bool m_dragging;
+    bool m_dragSubtree;
+    QList<Node *> m_dragNodes;
+    QPointF m_dragOffset;
+
+    // scene index
+    bool bulkChange() const;
+    bool m_readingFile;
+    static const int m_bspIndexItems;
+    static const int m_bulkDragNodes;
+
+    // the EdgeLayer is switched on when the map reaches m_edgeLayerEdges
+    // Edges, not during a bulk change; it stays on for smaller maps too
+    void updateEdgeLayer();
+    static const int m_edgeLayerEdges;
+
+    // journal saving
+    bool m_journalMode;
+    QString m_snapshotFileName;
+    QByteArray m_snapshotStamp;
+    QList<QPointer<Node> > m_editedNodes;
+
+    // background saving
+    QFutureWatcher<QString> m_saveWatcher;
+    QString m_savingFileName;
+    int m_savingGeneration;
+    QList<QPointer<Node> > m_savingEditedNodes;
+    int m_mapGeneration;
+    QString m_pendingSaveFileName;
+    MapData m_pendingSave;
+    int m_pendingSaveGeneration;
+    QList<QPointer<Node> > m_pendingEditedNodes;
+
+    // progressive loading
+    QFutureWatcher<LoadingMap> m_loadWatcher;
+    QTimer m_loadTimer;
+    bool m_loading;
+    QString m_loadingFileName;
+    LoadingMap m_loadingMap;
+    QHash<int, QPointer<Node> > m_loadedNodes;
+    int m_loadedNodeCount;
+    int m_loadedEdgeCount;
+
+    static const int m_loadBatchTime; // ms per event loop turn
+    static const int m_loadChunkSize;
+
+    // image export
+    static const int m_sceneDpi;
+    static const qint64 m_exportBandMemory;
+    static const int m_exportTileSize;
+    static const int m_exportMargin;
 };
 
 #endif // GRAPHLOGIC_H
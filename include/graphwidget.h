@@ -15,6 +15,7 @@ class GraphLogic;
   * - Handle scene zoom in/out events
   * - Close scene (clean), new scene (clean & add first node)
   * - Pass key events to GraphLogic
+  * - Grow the canvas (the scene rect) to hold the content
   */
 class GraphWidget : public QGraphicsView
 {
@@ -29,7 +30,14 @@ public:
 
     GraphLogic *graphLogic() const;
 
+    // the canvas is never smaller than m_defaultCanvas, it grows with a
+    // margin when the content leaves it and it shrinks only at reset
+    void growCanvas(const QRectF &content);
+    void resetCanvas();
+
     static const QColor m_paperColor;
+    static const QRectF m_defaultCanvas;
+    static const qreal m_canvasMargin;
 
 public slots:
 
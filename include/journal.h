@@ -0,0 +1,64 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <QString>
+#include <QByteArray>
+#include <QList>
+
+/** Append-only log of the changes made since the map file was written.
+  * Kept next to the map as "<map file>.journal".
+  *
+  * Layout: header (magic, version, size and modification time of the map
+  * file it continues), then batches, one per save: batch length, records.
+  * A record is a RecordType followed by the arguments of the change,
+  * written by the undo commands in commands.cpp and replayed by
+  * GraphLogic::replayJournal().
+  */
+class Journal
+{
+public:
+
+    enum RecordType
+    {
+        InsertNodeRecord = 1,
+        RemoveNodesRecord,
+        AddEdgeRecord,
+        RemoveEdgeRecord,
+        MoveRecord,
+        NodeColorRecord,
+        NodeTextColorRecord,
+        ScaleRecord,
+        NodeHtmlRecord,     // written before the compact node contents
+        NodeContentRecord
+    };
+
+    explicit Journal(const QString &mapFileName);
+
+    QString fileName() const;
+    bool exists() const;
+
+    // identifies the current version of the map file
+    QByteArray mapStamp() const;
+
+    // the journal was started on the current version of the map file
+    bool belongsToMap() const;
+
+    // the journal grew too big, time to write the whole map again
+    bool needsCompaction() const;
+
+    // complete batches, a partially written last batch is dropped
+    QList<QByteArray> readBatches() const;
+
+    // starts the journal if needed
+    bool append(const QByteArray &batch) const;
+
+    void remove() const;
+
+private:
+
+    QString m_mapFileName;
+
+    static const qint64 m_minimumCompactionSize;
+};
+
+#endif // JOURNAL_H
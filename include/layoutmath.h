@@ -0,0 +1,44 @@
+#ifndef LAYOUTMATH_H
+#define LAYOUTMATH_H
+
+#include <QList>
+#include <QPointF>
+#include <QRectF>
+
+/** Geometry of the map layout without the scene items, so tools and
+  * benchmarks can use it from the core library. Angles are in radians.
+  */
+namespace LayoutMath
+{
+    static const double pi = 3.14159265358979323846264338327950288419717;
+    static const double twoPi = pi * 2.0;
+
+    // remainder of the truncated division, like fmod()
+    double modulo(const double &devided, const double &devisor);
+
+    /** The middle of the biggest gap between the directions of the edges
+      * of a node, counted the same way as Node::calculateBiggestAngle().
+      * @param angles directions of the edges pointing out of the node,
+      *               at least one
+      */
+    double biggestGapAngle(QList<double> angles);
+
+    /** Rounded rect as QPainterPath::addRoundedRect() makes it with
+      * absolute radii: a radius bigger than half of the side is clamped.
+      */
+    bool roundedRectContains(const QRectF &rect,
+                             qreal xRadius, qreal yRadius,
+                             const QPointF &point);
+
+    /** Where the ray from origin towards direction leaves the rounded rect,
+      * in closed form. The rect is convex, so there is one such point if
+      * origin is inside; origin itself is returned if it is outside or
+      * the direction is null.
+      */
+    QPointF roundedRectExit(const QRectF &rect,
+                            qreal xRadius, qreal yRadius,
+                            const QPointF &origin,
+                            const QPointF &direction);
+}
+
+#endif // LAYOUTMATH_H
@@ -5,6 +5,8 @@
 #include <QSystemTrayIcon>
 #include <QSignalMapper>
 #include <QUndoView>
+#include <QProgressBar>
+#include <QPushButton>
 
 #include "graphwidget.h"
 
@@ -38,8 +40,11 @@ public slots:
     // filemenu actions
     void newFile();
     void openFile(const QString &fileName = "");
+    void loadProgress(const int &done, const int &total);
+    void openFinished(const bool &success);
     void saveFile(const bool &checkIfReadonly = true);
     bool saveFileAs();
+    bool saveFileAsBinary();
     bool closeFile();
     void exportScene();
     void about();
@@ -67,8 +72,13 @@ private:
     Ui::MainWindow *m_ui;
     GraphWidget *m_graphicsView;
     QString m_fileName;
+    QString m_previousFileName;
     bool m_contentChanged;
 
+    // opening a file in the statusbar
+    QProgressBar *m_loadProgress;
+    QPushButton *m_loadCancel;
+
     // main toolbar actions
     QAction *m_addNode;
     QAction *m_delNode;
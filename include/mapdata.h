@@ -0,0 +1,83 @@
+#ifndef MAPDATA_H
+#define MAPDATA_H
+
+#include <QString>
+#include <QVector>
+
+/** Colors of the map are stored as 0xAARRGGBB, the same way as QRgb,
+  * so the file handling code does not depend on QtGui.
+  */
+inline quint32 mapColor(const int &red, const int &green, const int &blue)
+{
+    return 0xff000000u | ((red & 0xff) << 16) | ((green & 0xff) << 8) |
+            (blue & 0xff);
+}
+
+inline int mapColorRed(const quint32 &color) { return (color >> 16) & 0xff; }
+inline int mapColorGreen(const quint32 &color) { return (color >> 8) & 0xff; }
+inline int mapColorBlue(const quint32 &color) { return color & 0xff; }
+
+// Edge::setWidth ignores the widths out of this range, the replay too
+inline bool isEdgeWidth(const qreal &width)
+{
+    return width >= 1 && width <= 100;
+}
+
+// a Node as it is stored in a map file
+struct NodeData
+{
+    // how m_content is stored, Node expands it to a document
+    enum ContentType
+    {
+        HtmlDocument = 0,   // QTextDocument::toHtml(), the old files
+        HtmlFragment,       // inside of <body>, without the header
+        PlainText           // the node has no formatting at all
+    };
+
+    int m_id;
+    qreal m_x;
+    qreal m_y;
+    qreal m_scale;
+    quint32 m_color;
+    quint32 m_textColor;
+    ContentType m_contentType;
+    QString m_content;
+
+    NodeData()
+        : m_id(-1)
+        , m_x(0)
+        , m_y(0)
+        , m_scale(1)
+        , m_color(0xff000000u)
+        , m_textColor(0xff000000u)
+        , m_contentType(HtmlDocument)
+        , m_content()
+    {};
+};
+
+// an Edge as it is stored in a map file, end nodes referred by id
+struct EdgeData
+{
+    int m_source;
+    int m_destination;
+    quint32 m_color;
+    qreal m_width;
+    bool m_secondary;
+
+    EdgeData()
+        : m_source(-1)
+        , m_destination(-1)
+        , m_color(0xff000000u)
+        , m_width(1)
+        , m_secondary(false)
+    {};
+};
+
+// copy of a whole map, it can be written while the scene changes
+struct MapData
+{
+    QVector<NodeData> m_nodes;
+    QVector<EdgeData> m_edges;
+};
+
+#endif // MAPDATA_H
@@ -0,0 +1,126 @@
+#ifndef MAPREADER_H
+#define MAPREADER_H
+
+#include <QFile>
+#include <QScopedPointer>
+#include <QXmlStreamReader>
+
+#include "mapdata.h"
+
+/** Pull reader of map files, one node or edge at a time.
+  * All the nodes are read before the first edge.
+  *
+  * Usage:
+  *   MapReader *reader = MapReader::open(fileName);
+  *   while (reader->readNext() != MapReader::EndOfMap && !reader->hasError())
+  *       ... reader->node() or reader->edge() ...
+  */
+class MapReader
+{
+public:
+
+    enum TokenType
+    {
+        Invalid = 0,
+        NodeRecord,
+        EdgeRecord,
+        EndOfMap
+    };
+
+    // picks the reader by the content of the file, 0 if it can't be opened
+    static MapReader *open(const QString &fileName);
+
+    /** reads and checks the whole map, the ids are unique and the edges
+      * refer to existing nodes. Thread safe.
+      * @return error message, empty on success
+      */
+    static QString read(const QString &fileName, MapData *map);
+
+    virtual ~MapReader() {}
+
+    virtual TokenType readNext() = 0;
+
+    // valid after readNext() returned NodeRecord/EdgeRecord
+    const NodeData &node() const;
+    const EdgeData &edge() const;
+
+    // the reader stops at the first error
+    virtual void raiseError(const QString &message);
+    bool hasError() const;
+    virtual QString errorString() const;
+
+protected:
+
+    MapReader() : m_error() {}
+
+    // set by open(), the reader deletes the file it opened
+    QScopedPointer<QIODevice> m_ownedDevice;
+
+    NodeData m_node;
+    EdgeData m_edge;
+    QString m_error;
+};
+
+// the .qmm XML format, streamed with QXmlStreamReader
+class XmlMapReader : public MapReader
+{
+public:
+
+    XmlMapReader(QIODevice *device);
+
+    TokenType readNext();
+    void raiseError(const QString &message);
+    QString errorString() const;
+
+private:
+
+    enum State
+    {
+        Start = 0,
+        Nodes,
+        Edges,
+        End
+    };
+
+    void readNodeElement();
+    void readEdgeElement();
+
+    QXmlStreamReader m_xml;
+    State m_state;
+    int m_position;
+};
+
+// the .qmmb binary format, read through QFile::map
+class BinaryMapReader : public MapReader
+{
+public:
+
+    BinaryMapReader(QFile *file);
+    ~BinaryMapReader();
+
+    TokenType readNext();
+
+    int nodeCount() const;
+    int edgeCount() const;
+
+private:
+
+    void readNodeRecord(const uchar *record);
+    void readEdgeRecord(const uchar *record);
+
+    QFile *m_file;
+    uchar *m_map;
+    QByteArray m_buffer;
+    const uchar *m_data;
+    qint64 m_size;
+
+    quint32 m_nodeCount;
+    quint32 m_edgeCount;
+    quint32 m_heapOffset;
+    quint32 m_heapSize;
+    quint32 m_nodeTableOffset;
+    quint32 m_edgeTableOffset;
+    quint32 m_next;
+};
+
+#endif // MAPREADER_H
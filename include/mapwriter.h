@@ -0,0 +1,100 @@
+#ifndef MAPWRITER_H
+#define MAPWRITER_H
+
+#include <QIODevice>
+#include <QXmlStreamWriter>
+
+#include "mapdata.h"
+
+/** Push writer of map files: begin(), all the nodes, all the edges, end().
+  * Nothing bigger than a node is kept in memory, except the fixed-width
+  * tables of the binary format.
+  */
+class MapWriter
+{
+public:
+
+    enum Format
+    {
+        XmlFormat = 0,
+        BinaryFormat
+    };
+
+    // .qmmb files are binary, everything else is XML
+    static Format formatOfFileName(const QString &fileName);
+    static MapWriter *create(QIODevice *device, const Format &format);
+
+    /** writes the map to a temporary file, syncs it to the disk and moves
+      * it to the place of the file, so a crash leaves the old file intact.
+      * Thread safe, the format is chosen by the file name.
+      * @return error message, empty on success
+      */
+    static QString write(const QString &fileName, const MapData &map);
+
+    // copies a map file to another format without loss, through a
+    // temporary file like write()
+    static bool convert(const QString &sourceFileName,
+                        const QString &destinationFileName,
+                        QString *errorString = 0);
+
+    virtual ~MapWriter() {}
+
+    virtual void begin() = 0;
+    virtual void writeNode(const NodeData &node) = 0;
+    virtual void writeEdge(const EdgeData &edge) = 0;
+
+    // @return false if the device could not be written
+    virtual bool end() = 0;
+
+protected:
+
+    MapWriter(QIODevice *device) : m_device(device) {}
+
+    QIODevice *m_device;
+
+private:
+
+    // syncs the written temporary file and moves it to fileName,
+    // the temporary file is removed if it fails
+    static bool replaceFile(QFile *file, const QString &fileName);
+};
+
+// the .qmm XML format, streamed with QXmlStreamWriter
+class XmlMapWriter : public MapWriter
+{
+public:
+
+    XmlMapWriter(QIODevice *device);
+
+    void begin();
+    void writeNode(const NodeData &node);
+    void writeEdge(const EdgeData &edge);
+    bool end();
+
+private:
+
+    QXmlStreamWriter m_xml;
+    bool m_writingNodes;
+};
+
+// the .qmmb binary format, the device has to be seekable
+class BinaryMapWriter : public MapWriter
+{
+public:
+
+    BinaryMapWriter(QIODevice *device);
+
+    void begin();
+    void writeNode(const NodeData &node);
+    void writeEdge(const EdgeData &edge);
+    bool end();
+
+private:
+
+    QByteArray m_nodeTable;
+    QByteArray m_edgeTable;
+    quint32 m_heapSize;
+    bool m_ok;
+};
+
+#endif // MAPWRITER_H
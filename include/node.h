@@ -2,8 +2,9 @@
 #define NODE_H
 
 #include <QGraphicsTextItem>
+#include <QHash>
+#include <QVector>
 #include <QTextCursor>
-#include <QGraphicsDropShadowEffect>
 
 #include "edge.h"
 //#include "graphwidget.h"
@@ -29,22 +30,49 @@ public:
     void removeEdges();
 
 
+    // called by Edge::setSecondary()
+    void edgeSecondaryChanged(Edge *edge);
+
     // graph traversal
     QList<Edge *> edges() const;
     QList<Edge *> edgesFrom(const bool &excludeSecondaries = true) const;
     QList<Edge *> edgesToThis(const bool &excludeSecondaries = true) const;
     Edge * edgeTo(const Node* node) const;
-    QList<Node *> subtree() const;
+    QList<Node *> subtree() const;     // this Node first, then preorder
+    bool isInSubtreeOf(const Node *root) const;
     bool isConnected(const Node *node) const;
 
+    // the edges by kind without building a list
+    const QList<Edge *> &childEdges() const;     // primary edges from this
+    const QList<Edge *> &parentEdges() const;    // the primary edge to this
+    const QList<Edge *> &secondaryEdges() const; // of both directions
+    int edgeCount() const;
+
     // prop set/get
+    GraphLogic *graphLogic() const;
+    int id() const;
+    void setId(const int &id);
     void setBorder(const bool &hasBorder = true);
     void setEditable(const bool &editable = true);
     void setColor(const QColor &color);
     QColor color() const;
     void setTextColor(const QColor &color);
     QColor textColor() const;
-    void setScale(const qreal &factor, const QRectF &sceneRect);
+
+    // the content in its shortest stored form, see NodeData::ContentType
+    QString content(NodeData::ContentType *type) const;
+    void setContent(const NodeData::ContentType &type, const QString &content);
+
+    // the same on any document, usable outside the GUI thread
+    static QString compactContent(const QTextDocument *document,
+                                  NodeData::ContentType *type);
+    static void setDocumentContent(QTextDocument *document,
+                                   const NodeData::ContentType &type,
+                                   const QString &content);
+
+    // takes a laid out document, it must belong to the GUI thread already
+    void setDocument(QTextDocument *document);
+    void setScale(const qreal &factor);  // relative to the current scale
 
     // show numbers in hint mode
     void showNumber(const int &number, const bool& show = true,
@@ -58,12 +86,12 @@ public:
 
     // calculetes the intersection of line and shape of this Node
     QPointF intersection(const QLineF &line, const bool &reverse = false) const;
+    QPainterPath shape() const;
 
     // returns with the biggest angle between the edges
     double calculateBiggestAngle() const;
 
     static const QPointF newNodeCenter;
-    static const QPointF newNodeBottomRigth;
 
 signals:
 
@@ -73,6 +101,11 @@ signals:
     void nodeMoved(QGraphicsSceneMouseEvent *event);
     void nodeLostFocus();
 
+private slots:
+
+    void contentsChanged();
+    void documentSizeChanged();
+
 protected:
 
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
@@ -82,35 +115,59 @@ protected:
     void mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event);
     void mouseReleaseEvent(QGraphicsSceneMouseEvent *event);
     void mouseMoveEvent(QGraphicsSceneMouseEvent *event);
-    QPainterPath shape () const;
     void focusOutEvent(QFocusEvent *event);
 
 private:
 
-    double doubleModulo(const double &devided, const double &devisor) const;
+    QList<Node *> collectSubtree() const;
 
-    struct EdgeElement
-    {
-        Edge *edge;
-        bool startsFromThisNode;
-        EdgeElement(Edge *e, bool s) : edge(e), startsFromThisNode(s) {}
-    };
+    // the tiers of paint()
+    void paintFull(QPainter *painter, const QStyleOptionGraphicsItem *option,
+                   QWidget *widget);
+    void paintShape(QPainter *painter);
+    void paintGreekedText(QPainter *painter);
+    QColor backgroundColor() const;
 
+    // the list of the kind of the Edge
+    QList<Edge *> *edgeListOf(Edge *edge);
+    void adjustEdges();
 
-    QList<EdgeElement> m_edgeList;
+    // every Edge is in the hash by its other end and in one of the lists
+    QHash<const Node *, Edge *> m_edgeOfNode;
+    QList<Edge *> m_childEdges;
+    QList<Edge *> m_parentEdges;
+    QList<Edge *> m_secondaryEdges;
     GraphLogic *m_graphLogic;
+    int m_id;
     int m_number;
     bool m_hasBorder;
     bool m_numberIsSpecial;
     QColor m_color;
     QColor m_textColor;
-    QGraphicsDropShadowEffect *m_effect;
+
+    // compactContent() of the document, generated when needed
+    mutable QString m_content;
+    mutable NodeData::ContentType m_contentType;
+    mutable bool m_contentValid;
+
+    // the lines of the text as bars, in item coordinates
+    QVector<QRectF> m_greekedLines;
+    bool m_greekedLinesValid;
 
     static const double m_pi;
     static const double m_oneAndHalfPi;
     static const double m_twoPi;
 
     static const QColor m_gold;
+
+    // corner radii of shape() in item coordinates
+    static const qreal m_shapeXRadius;
+    static const qreal m_shapeYRadius;
+
+    // levelOfDetailFromTransform() limits: a plain box below m_boxDetail,
+    // bars for the lines below m_textDetail, the text from there
+    static const qreal m_boxDetail;
+    static const qreal m_textDetail;
 };
 
 #endif // NODE_H
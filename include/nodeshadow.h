@@ -0,0 +1,41 @@
+#ifndef NODESHADOW_H
+#define NODESHADOW_H
+
+#include <QGraphicsObject>
+#include <QPainterPath>
+#include <QPointer>
+
+class Node;
+
+/** The shadow of the active Node: one item of the scene under the Node
+  * it follows, instead of a graphics effect on every Node. GraphLogic
+  * moves it after the Node, see GraphLogic::nodeGeometryChanged().
+  */
+class NodeShadow : public QGraphicsObject
+{
+public:
+
+    NodeShadow();
+
+    // 0 hides the shadow
+    void setNode(Node *node);
+    Node *node() const;
+
+    // takes the position, scale and shape of the Node again
+    void updateGeometry();
+
+    QRectF boundingRect() const;
+    void paint(QPainter *painter,
+               const QStyleOptionGraphicsItem *option,
+               QWidget *widget);
+
+    static const QColor m_color;
+    static const QPointF m_offset;
+
+private:
+
+    QPointer<Node> m_node;
+    QPainterPath m_shape;
+};
+
+#endif // NODESHADOW_H
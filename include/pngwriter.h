@@ -0,0 +1,51 @@
+#ifndef PNGWRITER_H
+#define PNGWRITER_H
+
+#include <QIODevice>
+#include <QByteArray>
+
+#include <zlib.h>
+
+/** Streaming PNG encoder: begin(), the rows from top to bottom, end().
+  * Only the deflate state and one output chunk are kept in memory,
+  * so the image can be bigger than the address space.
+  * 8 bit RGB, no alpha: the map is exported on opaque paper.
+  */
+class PngWriter
+{
+public:
+
+    PngWriter(QIODevice *device, const int &width, const int &height,
+              const int &dpi = 96);
+    ~PngWriter();
+
+    bool begin();
+
+    // one row of width 0xffRRGGBB pixels, the format of QImage::Format_RGB32
+    bool writeRow(const quint32 *pixels);
+
+    // checks that all the rows have been written
+    bool end();
+
+private:
+
+    bool writeChunk(const char *type, const char *data, const int &size);
+    bool deflateRow(const int &flush);
+
+    QIODevice *m_device;
+    int m_width;
+    int m_height;
+    int m_dpi;
+    int m_row;
+    bool m_ok;
+    bool m_started;
+
+    z_stream m_stream;
+    QByteArray m_rowBuffer;     // filter byte and the RGB bytes of a row
+    QByteArray m_output;        // deflated data of the next IDAT chunk
+    int m_outputSize;
+
+    static const int m_chunkSize = 64 * 1024;
+};
+
+#endif // PNGWRITER_H
@@ -0,0 +1,37 @@
+#ifndef SCENESNAPSHOT_H
+#define SCENESNAPSHOT_H
+
+#include <QGraphicsScene>
+#include <QPainter>
+#include <QVector>
+
+/** Read-only copy of what the items of a scene paint, recorded on the
+  * GUI thread into a QPicture per item. Painting it does not touch the
+  * scene, so any number of threads can render tiles of it at once
+  * (if QFontDatabase::supportsThreadedFontRendering()).
+  * The items are recorded at the scale the snapshot is rendered at: they
+  * choose their level of detail from it, as on a view of that zoom.
+  */
+class SceneSnapshot
+{
+public:
+
+    explicit SceneSnapshot(QGraphicsScene *scene, const qreal &scale = 1);
+
+    // paints the items intersecting the rect of the scene, thread safe;
+    // the painter is expected to be scaled by the scale of the snapshot
+    void render(QPainter *painter, const QRectF &source) const;
+
+private:
+
+    struct Item
+    {
+        QRectF m_bounds;            // in scene coordinates
+        QByteArray m_picture;       // QPicture::data() of the painting
+    };
+
+    QVector<Item> m_items;          // in stacking order, bottom first
+    qreal m_scale;
+};
+
+#endif // SCENESNAPSHOT_H
@@ -0,0 +1,63 @@
+#ifndef SUBTREEINDEX_H
+#define SUBTREEINDEX_H
+
+#include <QList>
+#include <QVector>
+#include <QHash>
+
+class Node;
+
+/** Preorder numbering of the primary edges of the map: the subtree of a
+  * Node is one contiguous range of the order.
+  * Changes of the tree only mark the numbering as stale. Numbering the
+  * whole map again costs more than walking one subtree, so it is built
+  * only after m_buildQueries queries have found the tree unchanged;
+  * while the map is edited the Nodes walk their subtrees themselves.
+  */
+class SubtreeIndex
+{
+public:
+
+    explicit SubtreeIndex(const QList<Node *> *nodes);
+
+    // the primary tree or the set of the Nodes has changed
+    void invalidate();
+
+    // a subtree is asked for, true if the index should answer it: it is
+    // built already or the tree has not changed for enough queries
+    bool useForQuery();
+
+    // false for Nodes which are not in the scene
+    bool contains(const Node *node) const;
+
+    int subtreeSize(const Node *root) const;
+
+    // root first, then its descendants in preorder
+    QList<Node *> subtree(const Node *root) const;
+    Node * const *subtreeBegin(const Node *root) const;
+    Node * const *subtreeEnd(const Node *root) const;
+
+private:
+
+    // a Node on the path of the traversal
+    struct Level
+    {
+        Node *m_node;
+        int m_position;
+        int m_nextChild;
+    };
+
+    void build() const;
+
+    const QList<Node *> *m_nodes;
+
+    mutable bool m_valid;
+    int m_staleQueries;     // answered without the index since the change
+    mutable QVector<Node *> m_order;
+    mutable QVector<int> m_end;     // the end of the range of m_order[i]
+    mutable QHash<const Node *, int> m_position;
+
+    static const int m_buildQueries;
+};
+
+#endif // SUBTREEINDEX_H
@@ -1,57 +1,12 @@
+# the core library first, the application links it
+TEMPLATE      = subdirs
 
-#version check qt: some functions introduced in 4.6
-contains(QT_VERSION, ^4\\.[0-5]\\..*) {
-message("Cannot build Qt Creator with Qt version $${QT_VERSION}.")
-error("Use at least Qt 4.6.")
-}
+SUBDIRS       = core app
 
-QT       += core gui svg xml
+# all the projects are in this directory, the Makefiles need own names
+core.file     = qtmindmap_core.pro
+core.makefile = Makefile.core
 
-CONFIG   += warn_on
-
-TARGET    = qtmindmap
-
-TEMPLATE  = app
-
-
-SOURCES += src/main.cpp \
-           src/mainwindow.cpp \
-           src/graphwidget.cpp \
-           src/graphlogic.cpp \
-           src/node.cpp \
-           src/edge.cpp \
-           src/systemtray.cpp \
-           src/argumentparser.cpp \
-           src/commands.cpp
-
-
-HEADERS  += include/mainwindow.h \
-            include/graphwidget.h \
-            include/graphlogic.h \
-            include/node.h \
-            include/edge.h \
-            include/systemtray.h \
-            include/argumentparser.h \
-            include/commands.h
-
-
-FORMS        += ui/mainwindow.ui
-
-RESOURCES    += images/qtmindmap.qrc
-
-
-# the translation hack
-include(lang/locale.pri)
-
-INSTALLS += target translations desktop icon
-
-target.path = /usr/bin
-
-translations.files += .qm/i18n
-translations.path += /usr/share/qtmindmap
-
-desktop.files += other/qtmindmap.desktop
-desktop.path += /usr/share/applications
-
-icon.files += images/qtmindmap.svg
-icon.path += /usr/share/pixmaps
+app.file      = qtmindmap_app.pro
+app.makefile  = Makefile.app
+app.depends   = core
@@ -0,0 +1,69 @@
+
+#version check qt: some functions introduced in 4.7
+contains(QT_VERSION, ^4\\.[0-6]\\..*) {
+message("Cannot build Qt Creator with Qt version $${QT_VERSION}.")
+error("Use at least Qt 4.7.")
+}
+
+QT       += core gui svg xml
+
+CONFIG   += warn_on
+
+include(qtmindmap_core.pri)
+
+TARGET    = qtmindmap
+
+TEMPLATE  = app
+
+
+SOURCES += src/main.cpp \
+           src/mainwindow.cpp \
+           src/graphwidget.cpp \
+           src/graphlogic.cpp \
+           src/node.cpp \
+           src/edge.cpp \
+           src/systemtray.cpp \
+           src/argumentparser.cpp \
+           src/commands.cpp \
+           src/scenesnapshot.cpp \
+           src/subtreeindex.cpp \
+           src/edgelayer.cpp \
+           src/nodeshadow.cpp \
+           src/batchrunner.cpp
+
+
+HEADERS  += include/mainwindow.h \
+            include/graphwidget.h \
+            include/graphlogic.h \
+            include/node.h \
+            include/edge.h \
+            include/systemtray.h \
+            include/argumentparser.h \
+            include/commands.h \
+            include/scenesnapshot.h \
+            include/subtreeindex.h \
+            include/edgelayer.h \
+            include/nodeshadow.h \
+            include/batchrunner.h
+
+
+FORMS        += ui/mainwindow.ui
+
+RESOURCES    += images/qtmindmap.qrc
+
+
+# the translation hack
+include(lang/locale.pri)
+
+INSTALLS += target translations desktop icon
+
+target.path = /usr/bin
+
+translations.files += .qm/i18n
+translations.path += /usr/share/qtmindmap
+
+desktop.files += other/qtmindmap.desktop
+desktop.path += /usr/share/applications
+
+icon.files += images/qtmindmap.svg
+icon.path += /usr/share/pixmaps
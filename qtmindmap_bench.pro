@@ -0,0 +1,39 @@
+QT       += core gui svg xml
+
+CONFIG += qtestlib
+
+include(qtmindmap_core.pri)
+
+TARGET = qtmindmap_bench
+
+SOURCES += src/mainwindow.cpp \
+           src/graphwidget.cpp \
+           src/graphlogic.cpp \
+           src/node.cpp \
+           src/edge.cpp \
+           src/systemtray.cpp \
+           src/argumentparser.cpp \
+           src/commands.cpp \
+           src/scenesnapshot.cpp \
+           src/subtreeindex.cpp \
+           src/edgelayer.cpp \
+           src/nodeshadow.cpp \
+           test/filebenchmarks.cpp
+
+HEADERS  += include/mainwindow.h \
+            include/graphwidget.h \
+            include/graphlogic.h \
+            include/node.h \
+            include/edge.h \
+            include/systemtray.h \
+            include/argumentparser.h \
+            include/commands.h \
+            include/scenesnapshot.h \
+            include/subtreeindex.h \
+            include/edgelayer.h \
+            include/nodeshadow.h \
+            test/filebenchmarks.h
+
+FORMS    += ui/mainwindow.ui
+
+RESOURCES = images/qtmindmap.qrc
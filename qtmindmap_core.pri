@@ -0,0 +1,3 @@
+# links the core library, qtmindmap_core.pro has to be built first
+LIBS           += -L$$OUT_PWD -lqtmindmapcore -lz
+PRE_TARGETDEPS += $$OUT_PWD/libqtmindmapcore.a
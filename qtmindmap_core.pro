@@ -0,0 +1,26 @@
+# The map data, file formats and layout math without QtGui,
+# for the application, the tests and command line tools.
+
+QT        = core
+
+CONFIG   += staticlib warn_on
+
+TARGET    = qtmindmapcore
+
+TEMPLATE  = lib
+
+
+SOURCES += src/mapreader.cpp \
+           src/mapwriter.cpp \
+           src/journal.cpp \
+           src/pngwriter.cpp \
+           src/layoutmath.cpp
+
+
+HEADERS  += include/mapdata.h \
+            include/mapreader.h \
+            include/mapwriter.h \
+            include/binarylayout.h \
+            include/journal.h \
+            include/pngwriter.h \
+            include/layoutmath.h
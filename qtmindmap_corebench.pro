@@ -0,0 +1,11 @@
+QT        = core
+
+CONFIG   += qtestlib
+
+include(qtmindmap_core.pri)
+
+TARGET    = qtmindmap_corebench
+
+SOURCES  += test/corebenchmarks.cpp
+
+HEADERS  += test/corebenchmarks.h
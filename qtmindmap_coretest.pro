@@ -0,0 +1,11 @@
+QT        = core
+
+CONFIG   += qtestlib
+
+include(qtmindmap_core.pri)
+
+TARGET    = qtmindmap_coretest
+
+SOURCES  += test/coretests.cpp
+
+HEADERS  += test/coretests.h
@@ -2,6 +2,8 @@ QT       += core gui svg xml
 
 CONFIG += qtestlib
 
+include(qtmindmap_core.pri)
+
 TARGET = qtmindmap_test
 
 SOURCES += src/mainwindow.cpp \
@@ -11,15 +13,25 @@ SOURCES += src/mainwindow.cpp \
            src/edge.cpp \
            src/systemtray.cpp \
            src/argumentparser.cpp \
+           src/commands.cpp \
+           src/scenesnapshot.cpp \
+           src/subtreeindex.cpp \
+           src/edgelayer.cpp \
+           src/nodeshadow.cpp \
            test/algorithmtests.cpp
 
 HEADERS  += include/mainwindow.h \
             include/graphwidget.h \
-            include/graphlogic.hpp \
+            include/graphlogic.h \
             include/node.h \
             include/edge.h \
             include/systemtray.h \
             include/argumentparser.h \
+            include/commands.h \
+            include/scenesnapshot.h \
+            include/subtreeindex.h \
+            include/edgelayer.h \
+            include/nodeshadow.h \
             test/algorithmtests.h
 
 FORMS    += ui/mainwindow.ui
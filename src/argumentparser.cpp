@@ -22,16 +22,106 @@ void ArgumentParser::printUsage()
               << "-s,  --show-minimized\t"
               << tr("Hide main window, just show systray icon.").toStdString()
               << std::endl << std::endl
+              << tr("Without a window, FILE is required:").toStdString()
+              << std::endl
+              << "--export-png PNG\t"
+              << tr("Exports FILE as a PNG image.").toStdString()
+              << std::endl
+              << "--dpi DPI\t\t"
+              << tr("Resolution of the PNG image, 96 by default.")
+                 .toStdString()
+              << std::endl
+              << "--export-svg SVG\t"
+              << tr("Exports FILE as an SVG image.").toStdString()
+              << std::endl
+              << "--convert-to FORMAT\t"
+              << tr("Writes FILE next to it in qmm or qmmb format.")
+                 .toStdString()
+              << std::endl
+              << "--batch LIST\t\t"
+              << tr("Runs the lines of LIST as the options above, "
+                    "in parallel.").toStdString()
+              << std::endl
+              << "--jobs N\t\t"
+              << tr("Number of parallel batch jobs, the number of cores "
+                    "by default.").toStdString()
+              << std::endl << std::endl
               << tr("Report bugs to: ").toStdString()
               << "denes.matetelki@gmail.com" << std::endl;
 }
 
 
+bool ArgumentParser::parseValueOptions(QStringList &cmdlineArgs)
+{
+    QRegExp valueOption(
+                "^--(export-png|export-svg|convert-to|batch|dpi|jobs)$");
+    int i;
+    while ((i = cmdlineArgs.indexOf(valueOption)) != -1)
+    {
+        QString option = cmdlineArgs.takeAt(i);
+        if (i == cmdlineArgs.size())
+        {
+            std::cerr << tr("Missing value of ").toStdString()
+                      << option.toStdString() << std::endl;
+            printUsage();
+            return false;
+        }
+
+        QString value = cmdlineArgs.takeAt(i);
+        bool ok = true;
+        if (option == "--export-png")
+        {
+            m_exportPngPath = value;
+        }
+        else if (option == "--export-svg")
+        {
+            m_exportSvgPath = value;
+        }
+        else if (option == "--convert-to")
+        {
+            m_convertFormat = value.toLower();
+            ok = m_convertFormat == "qmm" || m_convertFormat == "qmmb";
+        }
+        else if (option == "--batch")
+        {
+            m_batchPath = value;
+        }
+        else if (option == "--dpi")
+        {
+            m_dpi = value.toInt(&ok);
+            ok = ok && m_dpi > 0;
+        }
+        else
+        {
+            m_jobs = value.toInt(&ok);
+            ok = ok && m_jobs > 0;
+        }
+
+        if (!ok)
+        {
+            std::cerr << tr("Invalid value of ").toStdString()
+                      << option.toStdString() << ": "
+                      << value.toStdString() << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
 bool ArgumentParser::parseCmdLineArgs()
 {
     QStringList cmdlineArgs = QCoreApplication::arguments();
     cmdlineArgs.removeFirst();
 
+    return parseArgs(cmdlineArgs);
+}
+
+bool ArgumentParser::parseArgs(QStringList cmdlineArgs)
+{
+    if (!parseValueOptions(cmdlineArgs))
+        return false;
+
     QRegExp help("^-(h|-help)$");
     if (!cmdlineArgs.filter(help).isEmpty())
     {
@@ -94,6 +184,22 @@ bool ArgumentParser::parseCmdLineArgs()
             return false;
         }
     }
+
+    // a batch names its own files
+    if (!m_batchPath.isEmpty() && !m_filePath.isEmpty())
+    {
+        std::cerr << tr("--batch does not take a FILE.").toStdString()
+                  << std::endl;
+        return false;
+    }
+
+    if (m_batchPath.isEmpty() && isHeadless() && m_filePath.isEmpty())
+    {
+        std::cerr << tr("Missing FILE to export or convert.").toStdString()
+                  << std::endl;
+        return false;
+    }
+
     return true;
 }
 
@@ -111,3 +217,41 @@ QString ArgumentParser::filePath()
 {
     return m_filePath;
 }
+
+bool ArgumentParser::isHeadless()
+{
+    return !m_exportPngPath.isEmpty() ||
+           !m_exportSvgPath.isEmpty() ||
+           !m_convertFormat.isEmpty() ||
+           !m_batchPath.isEmpty();
+}
+
+QString ArgumentParser::exportPngPath()
+{
+    return m_exportPngPath;
+}
+
+QString ArgumentParser::exportSvgPath()
+{
+    return m_exportSvgPath;
+}
+
+QString ArgumentParser::convertFormat()
+{
+    return m_convertFormat;
+}
+
+QString ArgumentParser::batchPath()
+{
+    return m_batchPath;
+}
+
+int ArgumentParser::dpi()
+{
+    return m_dpi;
+}
+
+int ArgumentParser::jobs()
+{
+    return m_jobs;
+}
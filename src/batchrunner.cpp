@@ -0,0 +1,211 @@
+#include "include/batchrunner.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QThread>
+
+#include "include/graphwidget.h"
+#include "include/graphlogic.h"
+#include "include/mapwriter.h"
+
+#include <stdlib.h> // EXIT_FAILURE
+#include <iostream> // cerr
+
+BatchRunner::BatchRunner(QObject *parent)
+    : QObject(parent)
+    , m_failedJobs(0)
+{
+}
+
+int BatchRunner::run(ArgumentParser &arguments)
+{
+    if (!arguments.batchPath().isEmpty())
+        return runBatch(arguments.batchPath(), arguments.jobs());
+
+    return runJob(arguments);
+}
+
+void BatchRunner::printNotification(const QString &msg)
+{
+    std::cerr << msg.toStdString() << std::endl;
+}
+
+int BatchRunner::runJob(ArgumentParser &arguments)
+{
+    const QString fileName = arguments.filePath();
+
+    if (!arguments.convertFormat().isEmpty())
+    {
+        QFileInfo fileInfo(fileName);
+        QString destination = fileInfo.path() + "/" +
+                fileInfo.completeBaseName() + "." + arguments.convertFormat();
+
+        // the reader would read the file being overwritten
+        if (QFileInfo(destination) == fileInfo)
+        {
+            std::cerr << tr("File: ").toStdString()
+                      << fileName.toStdString()
+                      << tr(" is already in that format.").toStdString()
+                      << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        QString error;
+        if (!MapWriter::convert(fileName, destination, &error))
+        {
+            std::cerr << error.toStdString() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (arguments.exportPngPath().isEmpty() &&
+        arguments.exportSvgPath().isEmpty())
+        return EXIT_SUCCESS;
+
+    // the scene is needed for the images, its view is never on the screen
+    GraphWidget graphWidget;
+    graphWidget.setAttribute(Qt::WA_DontShowOnScreen);
+    GraphLogic *graphLogic = graphWidget.graphLogic();
+    connect(graphLogic, SIGNAL(notification(QString)),
+            this, SLOT(printNotification(QString)));
+
+    if (!graphLogic->readContentFromFile(fileName))
+        return EXIT_FAILURE;
+
+    if (!arguments.exportPngPath().isEmpty() &&
+        !graphLogic->writeContentToPngFile(arguments.exportPngPath(),
+                                           arguments.dpi()))
+        return EXIT_FAILURE;
+
+    if (!arguments.exportSvgPath().isEmpty() &&
+        !graphLogic->writeContentToSvgFile(arguments.exportSvgPath()))
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
+
+int BatchRunner::runBatch(const QString &listPath, const int &jobs)
+{
+    QFile list(listPath);
+    if (!list.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        std::cerr << tr("File: ").toStdString()
+                  << listPath.toStdString()
+                  << tr(" is not readable.").toStdString() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // a line is the options of one run, # starts a comment line
+    QTextStream stream(&list);
+    while (!stream.atEnd())
+    {
+        QString line = stream.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+
+        // a line which would open a window or an other batch never exits
+        QStringList arguments = splitLine(line);
+        ArgumentParser parser;
+        if (!parser.parseArgs(arguments) || !parser.isHeadless() ||
+            !parser.batchPath().isEmpty())
+        {
+            std::cerr << tr("Not a batch job: ").toStdString()
+                      << line.toStdString() << std::endl;
+            m_failedJobs++;
+            continue;
+        }
+
+        m_pendingJobs.append(arguments);
+    }
+
+    int parallelJobs = jobs > 0 ? jobs : qMax(1, QThread::idealThreadCount());
+    for (int i = 0; i < parallelJobs && startNextJob(); i++)
+        ;
+
+    if (!m_runningJobs.isEmpty())
+        m_loop.exec();
+
+    return m_failedJobs ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+bool BatchRunner::startNextJob()
+{
+    while (!m_pendingJobs.isEmpty())
+    {
+        QStringList arguments = m_pendingJobs.takeFirst();
+
+        QProcess *process = new QProcess(this);
+        process->setProcessChannelMode(QProcess::ForwardedChannels);
+        connect(process, SIGNAL(finished(int, QProcess::ExitStatus)),
+                this, SLOT(jobFinished(int, QProcess::ExitStatus)));
+
+        process->start(QCoreApplication::applicationFilePath(), arguments);
+        if (process->waitForStarted())
+        {
+            m_runningJobs.insert(process, arguments);
+            return true;
+        }
+
+        std::cerr << tr("Couldn't start: ").toStdString()
+                  << arguments.join(" ").toStdString() << std::endl;
+        m_failedJobs++;
+        delete process;
+    }
+
+    return false;
+}
+
+void BatchRunner::jobFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    QProcess *process = qobject_cast<QProcess *>(sender());
+    QStringList arguments = m_runningJobs.take(process);
+    process->deleteLater();
+
+    if (exitStatus != QProcess::NormalExit || exitCode != EXIT_SUCCESS)
+    {
+        std::cerr << tr("Failed: ").toStdString()
+                  << arguments.join(" ").toStdString() << std::endl;
+        m_failedJobs++;
+    }
+
+    startNextJob();
+    if (m_runningJobs.isEmpty())
+        m_loop.quit();
+}
+
+QStringList BatchRunner::splitLine(const QString &line)
+{
+    QStringList arguments;
+    QString argument;
+    bool quoted = false;
+    bool hasArgument = false;
+
+    foreach (QChar c, line)
+    {
+        if (c == '"')
+        {
+            quoted = !quoted;
+            hasArgument = true;
+        }
+        else if (c.isSpace() && !quoted)
+        {
+            if (hasArgument)
+                arguments.append(argument);
+
+            argument.clear();
+            hasArgument = false;
+        }
+        else
+        {
+            argument.append(c);
+            hasArgument = true;
+        }
+    }
+
+    if (hasArgument)
+        arguments.append(argument);
+
+    return arguments;
+}
@@ -1,7 +1,9 @@
 #include "include/commands.h"
+#include "include/journal.h"
 
 #include <QDebug>
 #include <QApplication>
+#include <QSet>
 
 #include <math.h>
 
@@ -26,6 +28,25 @@ BaseUndoClass::BaseUndoClass(UndoContext context)
     }
 }
 
+BaseUndoClass::BaseUndoClass(UndoContext context,
+                             const QList<Node *> &nodeList)
+    : m_done(false)
+    , m_context(context)
+    , m_activeNode(context.m_activeNode)
+    , m_nodeList(nodeList)
+    , m_subtree(context.m_subtree)
+{
+}
+
+QList<qint32> BaseUndoClass::nodeIds() const
+{
+    QList<qint32> ids;
+    foreach(Node *node, m_nodeList)
+        ids.append(node->id());
+
+    return ids;
+}
+
 
 
 InsertNodeCommand::InsertNodeCommand(UndoContext context)
@@ -49,6 +70,9 @@ InsertNodeCommand::InsertNodeCommand(UndoContext context)
     m_edge->setColor(m_node->color());
     m_edge->setWidth(m_node->scale()*2 + 1);
     m_edge->setSecondary(false);
+
+    // later scaling changes the width relatively, journal the initial one
+    m_width = m_edge->width();
 }
 
 InsertNodeCommand::~InsertNodeCommand()
@@ -96,6 +120,18 @@ void InsertNodeCommand::redo()
     m_done = true;
 }
 
+void InsertNodeCommand::writeJournal(QDataStream &stream) const
+{
+    stream << quint8(Journal::InsertNodeRecord)
+           << qint32(m_node->id())
+           << qint32(m_activeNode->id())
+           << double(m_context.m_pos.x())
+           << double(m_context.m_pos.y())
+           << quint32(m_node->color().rgb())
+           << quint32(m_node->textColor().rgb())
+           << double(m_width);
+}
+
 RemoveNodeCommand::RemoveNodeCommand(UndoContext context)
     : BaseUndoClass(context)
     , m_hintNode(context.m_hintNode)
@@ -105,11 +141,15 @@ RemoveNodeCommand::RemoveNodeCommand(UndoContext context)
                 m_subtree ?
                         QObject::tr(" with subtree") : QString("")));
 
-    // collect affected edges
+    // collect affected edges, an edge inside the subtree is met twice
+    QSet<Edge *> edges;
     foreach(Node *node, m_nodeList)
         foreach(Edge *edge, node->edges())
-            if (m_edgeList.indexOf(edge) == -1)
+            if (!edges.contains(edge))
+            {
+                edges.insert(edge);
                 m_edgeList.push_back(edge);
+            }
 }
 
 void RemoveNodeCommand::undo()
@@ -158,6 +198,12 @@ void RemoveNodeCommand::redo()
     m_context.m_graphLogic->reShowNumbers();
 }
 
+void RemoveNodeCommand::writeJournal(QDataStream &stream) const
+{
+    stream << quint8(Journal::RemoveNodesRecord)
+           << nodeIds();
+}
+
 AddEdgeCommand::AddEdgeCommand(UndoContext context)
     : BaseUndoClass(context)
 {
@@ -173,6 +219,7 @@ AddEdgeCommand::AddEdgeCommand(UndoContext context)
     m_edge = new Edge(m_context.m_source, m_context.m_destination);
     m_edge->setColor(m_context.m_destination->color());
     m_edge->setWidth(m_context.m_destination->scale()*2 + 1);
+    m_width = m_edge->width();
 
     // The Edge is secondary, because the Node already has a parent
     // (it is already a destination of another Edge)
@@ -200,6 +247,16 @@ void AddEdgeCommand::redo()
     m_done = true;
 }
 
+void AddEdgeCommand::writeJournal(QDataStream &stream) const
+{
+    stream << quint8(Journal::AddEdgeRecord)
+           << qint32(m_context.m_source->id())
+           << qint32(m_context.m_destination->id())
+           << quint32(m_edge->color().rgb())
+           << double(m_width)
+           << m_edge->secondary();
+}
+
 AddEdgeCommand::~AddEdgeCommand()
 {
     if (!m_done)
@@ -240,15 +297,26 @@ void RemoveEdgeCommand::redo()
     m_context.m_graphLogic->setActiveNode(m_context.m_activeNode);
 }
 
+void RemoveEdgeCommand::writeJournal(QDataStream &stream) const
+{
+    stream << quint8(Journal::RemoveEdgeRecord)
+           << qint32(m_context.m_source->id())
+           << qint32(m_context.m_destination->id());
+}
+
 MoveCommand::MoveCommand(UndoContext context)
     : BaseUndoClass(context)
+    , m_gesture(false)
 {
-    setText(QObject::tr("Node \"").append(
-                m_context.m_activeNode == m_context.m_nodeList->first() ?
-                    QObject::tr("Base node") :
-                    m_context.m_activeNode->toPlainText()).
-            append("\" moved (%1, %2)").arg(m_context.m_x).arg(m_context.m_y).
-            append(m_subtree ? QObject::tr(" with subtree") : QString("")));
+    setMoveText();
+}
+
+MoveCommand::MoveCommand(UndoContext context, const QList<Node *> &nodeList)
+    : BaseUndoClass(context, nodeList)
+    , m_gesture(true)
+{
+    m_done = true;
+    setMoveText();
 }
 
 void MoveCommand::undo()
@@ -257,14 +325,27 @@ void MoveCommand::undo()
         node->moveBy(-m_context.m_x, -m_context.m_y);
 
     m_context.m_graphLogic->setActiveNode(m_activeNode);
+    m_done = false;
 }
 
 void MoveCommand::redo()
 {
-    foreach(Node *node, m_nodeList)
-        node->moveBy(m_context.m_x, m_context.m_y);
+    if (!m_done)
+    {
+        foreach(Node *node, m_nodeList)
+            node->moveBy(m_context.m_x, m_context.m_y);
+    }
 
     m_context.m_graphLogic->setActiveNode(m_activeNode);
+    m_done = true;
+}
+
+void MoveCommand::writeJournal(QDataStream &stream) const
+{
+    stream << quint8(Journal::MoveRecord)
+           << nodeIds()
+           << double(m_context.m_x)
+           << double(m_context.m_y);
 }
 
 bool MoveCommand::mergeWith(const QUndoCommand *command)
@@ -283,19 +364,25 @@ bool MoveCommand::mergeWith(const QUndoCommand *command)
     m_context.m_x += moveCommand->m_context.m_x;
     m_context.m_y += moveCommand->m_context.m_y;
 
-    setText(QObject::tr("Node \"").append(
-                m_context.m_activeNode == m_context.m_nodeList->first() ?
-                    QObject::tr("Base node") :
-                    m_context.m_activeNode->toPlainText()).
-            append("\" moved (%1, %2)").arg(m_context.m_x).arg(m_context.m_y).
-            append(m_subtree ? QObject::tr(" with subtree") : QString("")));
+    setMoveText();
 
     return true;
 }
 
+// a drag is one step of the history, -1 is never merged
 int MoveCommand::id() const
 {
-    return MoveCommandId;
+    return m_gesture ? -1 : MoveCommandId;
+}
+
+void MoveCommand::setMoveText()
+{
+    setText(QObject::tr("Node \"").append(
+                m_context.m_activeNode == m_context.m_nodeList->first() ?
+                    QObject::tr("Base node") :
+                    m_context.m_activeNode->toPlainText()).
+            append("\" moved (%1, %2)").arg(m_context.m_x).arg(m_context.m_y).
+            append(m_subtree ? QObject::tr(" with subtree") : QString("")));
 }
 
 NodeColorCommand::NodeColorCommand(UndoContext context)
@@ -316,8 +403,12 @@ void NodeColorCommand::undo()
     foreach(Node *node, m_nodeList)
     {
         node->setColor(m_colorMap[node]);
-        foreach (Edge * edge, node->edgesToThis(false))
+        foreach (Edge * edge, node->parentEdges())
             edge->setColor(m_colorMap[node]);
+
+        foreach (Edge * edge, node->secondaryEdges())
+            if (edge->destNode() == node)
+                edge->setColor(m_colorMap[node]);
     }
 
     m_context.m_graphLogic->setActiveNode(m_activeNode);
@@ -328,13 +419,24 @@ void NodeColorCommand::redo()
     foreach(Node *node, m_nodeList)
     {
         node->setColor(m_context.m_color);
-        foreach (Edge * edge, node->edgesToThis(false))
+        foreach (Edge * edge, node->parentEdges())
             edge->setColor(m_context.m_color);
+
+        foreach (Edge * edge, node->secondaryEdges())
+            if (edge->destNode() == node)
+                edge->setColor(m_context.m_color);
     }
 
     m_context.m_graphLogic->setActiveNode(m_activeNode);
 }
 
+void NodeColorCommand::writeJournal(QDataStream &stream) const
+{
+    stream << quint8(Journal::NodeColorRecord)
+           << nodeIds()
+           << quint32(m_context.m_color.rgb());
+}
+
 NodeTextColorCommand::NodeTextColorCommand(UndoContext context)
     : BaseUndoClass(context)
 {
@@ -364,6 +466,13 @@ void NodeTextColorCommand::redo()
     m_context.m_graphLogic->setActiveNode(m_activeNode);
 }
 
+void NodeTextColorCommand::writeJournal(QDataStream &stream) const
+{
+    stream << quint8(Journal::NodeTextColorRecord)
+           << nodeIds()
+           << quint32(m_context.m_color.rgb());
+}
+
 ScaleNodeCommand::ScaleNodeCommand(UndoContext context)
     : BaseUndoClass(context)
 {
@@ -378,7 +487,7 @@ ScaleNodeCommand::ScaleNodeCommand(UndoContext context)
 void ScaleNodeCommand::undo()
 {
     foreach(Node *node, m_nodeList)
-        node->setScale(qreal(-m_context.m_scale), m_context.m_graphLogic->graphWidget()->sceneRect());
+        node->setScale(qreal(-m_context.m_scale));
 
     m_context.m_graphLogic->setActiveNode(m_activeNode);
 }
@@ -386,11 +495,18 @@ void ScaleNodeCommand::undo()
 void ScaleNodeCommand::redo()
 {
     foreach(Node *node, m_nodeList)
-        node->setScale(m_context.m_scale, m_context.m_graphLogic->graphWidget()->sceneRect());
+        node->setScale(m_context.m_scale);
 
     m_context.m_graphLogic->setActiveNode(m_activeNode);
 }
 
+void ScaleNodeCommand::writeJournal(QDataStream &stream) const
+{
+    stream << quint8(Journal::ScaleRecord)
+           << nodeIds()
+           << double(m_context.m_scale);
+}
+
 bool ScaleNodeCommand::mergeWith(const QUndoCommand *command)
 {
     if (command->id() != id())
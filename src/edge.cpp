@@ -4,6 +4,8 @@
 
 #include "include/edge.h"
 #include "include/node.h"
+#include "include/graphlogic.h"
+#include "include/edgelayer.h"
 
 #include <math.h>
 
@@ -17,17 +19,26 @@ Edge::Edge(Node *sourceNode, Node *destNode)
     , m_angle(-1)
     , m_color(0,0,0)
     , m_width(1)
+    , m_adjustPending(false)
+    , m_overlap(false)
     , m_secondary(false)
 {
     // does not interact with user
     setAcceptedMouseButtons(0);
     setZValue(1);
+    updatePens();
 
     adjust();
 }
 
 Edge::~Edge()
 {
+    if (m_adjustPending)
+        m_sourceNode->graphLogic()->cancelAdjust(this);
+
+    if (scene())
+        m_sourceNode->graphLogic()->edgeRemovedFromScene(this);
+
     m_sourceNode->removeEdge(this);
     m_destNode->removeEdge(this);
 }
@@ -55,6 +66,7 @@ QColor Edge::color() const
 void Edge::setColor(const QColor &color)
 {
     m_color = color;
+    updatePens();
     update();
 }
 
@@ -65,11 +77,13 @@ qreal Edge::width() const
 
 void Edge::setWidth(const qreal &width)
 {
-    if (width < 1 || width > 100)
+    if (!isEdgeWidth(width))
         return;
 
+    prepareGeometryChange();
     m_width = width;
-    update();
+    updatePens();
+    updateGeometry();
 }
 
 bool Edge::secondary() const
@@ -79,7 +93,13 @@ bool Edge::secondary() const
 
 void Edge::setSecondary(const bool &sec)
 {
+    if (sec == m_secondary)
+        return;
+
     m_secondary = sec;
+    m_sourceNode->edgeSecondaryChanged(this);
+    m_destNode->edgeSecondaryChanged(this);
+    updatePens();
     update();
 }
 
@@ -92,79 +112,164 @@ void Edge::adjust()
 
     m_destPoint = m_destNode->intersection(line, true);
     m_sourcePoint = m_sourceNode->sceneBoundingRect().center();
+
+    // no need to draw when the nodes overlap
+    m_overlap = m_sourceNode->collidesWithItem(m_destNode);
+
+    updateGeometry();
 }
 
-QRectF Edge::boundingRect() const
+// everything paint() and calculateBiggestAngle() need from the end points
+void Edge::updateGeometry()
 {
-    if (!m_sourceNode || !m_destNode)
-        return QRectF();
+    QLineF line(m_sourcePoint, m_destPoint);
+
+    // calculate angle
+    if (line.length() > 0)
+    {
+        m_angle = ::acos(line.dx() / line.length());
+        if (line.dy() >= 0)
+            m_angle = Edge::m_twoPi - m_angle;
+    }
+    else
+    {
+        m_angle = 0;
+    }
+
+    // no need to draw the arrow if the nodes are too close
+    qreal arrowSize = m_arrowSize + m_width;
+    if (line.length() < arrowSize)
+    {
+        m_arrow.clear();
+    }
+    else
+    {
+        m_arrow = QPolygonF() << m_destPoint
+            << m_destPoint +
+               QPointF(sin(m_angle - Edge::m_pi / 3) * arrowSize,
+                       cos(m_angle - Edge::m_pi / 3) * arrowSize)
+            << m_destPoint +
+               QPointF(sin(m_angle - Edge::m_pi + Edge::m_pi / 3) * arrowSize,
+                       cos(m_angle - Edge::m_pi + Edge::m_pi / 3) * arrowSize);
+    }
 
     qreal penWidth = 1;
     qreal extra = (penWidth + m_arrowSize  + m_width) / 2.0;
 
-    return QRectF(m_sourcePoint,
-                  QSizeF(m_destPoint.x() - m_sourcePoint.x(),
-                         m_destPoint.y() - m_sourcePoint.y()))
-                            .normalized().adjusted(-extra, -extra,
-                                                   extra, extra);
+    m_boundingRect = QRectF(m_sourcePoint,
+                            QSizeF(m_destPoint.x() - m_sourcePoint.x(),
+                                   m_destPoint.y() - m_sourcePoint.y()))
+                        .normalized().adjusted(-extra, -extra, extra, extra);
+    updateLayer();
 }
 
-void Edge::paint(QPainter *painter,
-                 const QStyleOptionGraphicsItem *,
-                 QWidget *w)
+void Edge::updatePens()
 {
-    Q_UNUSED(w);
+    // if secondary then dashline
+    m_linePen = QPen(m_color,
+                     m_width,
+                     m_secondary ?
+                         Qt::DashLine :
+                         Qt::SolidLine,
+                     Qt::RoundCap,
+                     Qt::RoundJoin);
+
+    m_arrowPen = QPen(m_color,
+                      m_width,
+                      Qt::SolidLine,
+                      Qt::RoundCap,
+                      Qt::RoundJoin);
+    updateLayer();
+}
 
-    // calculate angle
-    QLineF line(m_sourcePoint, m_destPoint);
+void Edge::updateLayer()
+{
+    EdgeLayer *layer = m_sourceNode->graphLogic()->edgeLayer();
+    if (layer)
+        layer->updateEdge(this);
+}
 
-    m_angle = ::acos(line.dx() / line.length());
-    if (line.dy() >= 0)
-        m_angle = Edge::m_twoPi - m_angle;
+void Edge::adjustLater()
+{
+    m_sourceNode->graphLogic()->scheduleAdjust(this);
+}
 
-    // no need to draw when the nodes overlap
-    if (sourceNode()->collidesWithItem(destNode()))
-        return;
+bool Edge::adjustPending() const
+{
+    return m_adjustPending;
+}
 
-    // Draw the line itself - if secondary then dashline
-    painter->setPen(QPen(m_color,
-                         m_width,
-                         m_secondary ?
-                             Qt::DashLine :
-                             Qt::SolidLine,
-                         Qt::RoundCap,
-                         Qt::RoundJoin));
-    painter->drawLine(line);
-
-    if (line.length() < m_arrowSize)
-        return;
+void Edge::setAdjustPending(const bool &pending)
+{
+    m_adjustPending = pending;
+}
 
-    // Draw the arrow
-    painter->setPen(QPen(m_color,
-                         m_width,
-                         Qt::SolidLine,
-                         Qt::RoundCap,
-                         Qt::RoundJoin));
+QVariant Edge::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+    if (change == ItemSceneHasChanged)
+    {
+        if (scene())
+        {
+            m_sourceNode->graphLogic()->edgeAddedToScene(this);
+        }
+        else
+        {
+            m_sourceNode->graphLogic()->edgeRemovedFromScene(this);
+        }
+    }
 
-    painter->setBrush(m_color);
-    qreal arrowSize = m_arrowSize + m_width;
+    return QGraphicsItem::itemChange(change, value);
+}
 
-    // no need to draw the arrow if the nodes are too close
-    if (line.length() < arrowSize)
-    {
-        painter->drawLine(m_sourcePoint, m_destPoint);
+QRectF Edge::boundingRect() const
+{
+    return m_boundingRect;
+}
+
+QLineF Edge::line() const
+{
+    return QLineF(m_sourcePoint, m_destPoint);
+}
+
+const QPolygonF &Edge::arrow() const
+{
+    return m_arrow;
+}
+
+const QPen &Edge::linePen() const
+{
+    return m_linePen;
+}
+
+const QPen &Edge::arrowPen() const
+{
+    return m_arrowPen;
+}
+
+bool Edge::overlaps() const
+{
+    return m_overlap;
+}
+
+// the geometry is calculated by adjust(), only drawing here
+void Edge::paint(QPainter *painter,
+                 const QStyleOptionGraphicsItem *,
+                 QWidget *w)
+{
+    Q_UNUSED(w);
+
+    if (m_overlap)
         return;
-    }
 
-    QPointF destArrowP1 = m_destPoint +
-                          QPointF(sin(m_angle - Edge::m_pi / 3) * arrowSize,
-                                  cos(m_angle - Edge::m_pi / 3) * arrowSize);
-    QPointF destArrowP2 = m_destPoint +
-              QPointF(sin(m_angle - Edge::m_pi + Edge::m_pi / 3) * arrowSize,
-                      cos(m_angle - Edge::m_pi + Edge::m_pi / 3) * arrowSize);
+    // Draw the line itself
+    painter->setPen(m_linePen);
+    painter->drawLine(m_sourcePoint, m_destPoint);
 
+    if (m_arrow.isEmpty())
+        return;
 
-    painter->drawPolygon(QPolygonF() << line.p2()
-                                     << destArrowP1
-                                     << destArrowP2);
+    // Draw the arrow
+    painter->setPen(m_arrowPen);
+    painter->setBrush(m_color);
+    painter->drawPolygon(m_arrow);
 }
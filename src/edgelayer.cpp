@@ -0,0 +1,264 @@
+#include "include/edgelayer.h"
+
+#include <QPainter>
+#include <QSet>
+#include <QStyleOptionGraphicsItem>
+
+#include "include/edge.h"
+
+#include <math.h>
+
+const qreal EdgeLayer::m_cellSize = 256;
+const int EdgeLayer::m_maxEdgeCells = 16;
+
+EdgeLayer::EdgeLayer()
+{
+    // does not interact with user, paint() needs the exposed rect
+    setAcceptedMouseButtons(0);
+    setFlag(ItemUsesExtendedStyleOption);
+    setZValue(1);
+}
+
+void EdgeLayer::insertEdge(Edge *edge)
+{
+    if (m_rectOfEdge.contains(edge))
+        return;
+
+    const QRectF rect = edge->boundingRect();
+    m_rectOfEdge.insert(edge, rect);
+    insertIntoCells(edge, cellsOf(rect));
+
+    if (!m_boundingRect.contains(rect))
+    {
+        prepareGeometryChange();
+        m_boundingRect |= rect;
+    }
+
+    update(rect);
+}
+
+void EdgeLayer::removeEdge(Edge *edge)
+{
+    if (!m_rectOfEdge.contains(edge))
+        return;
+
+    const QRectF rect = m_rectOfEdge.take(edge);
+    removeFromCells(edge, cellsOf(rect));
+    update(rect);
+}
+
+void EdgeLayer::updateEdge(Edge *edge)
+{
+    if (!m_rectOfEdge.contains(edge))
+        return;
+
+    const QRectF oldRect = m_rectOfEdge.value(edge);
+    const QRectF rect = edge->boundingRect();
+    if (rect != oldRect)
+    {
+        const QRect oldCells = cellsOf(oldRect);
+        const QRect cells = cellsOf(rect);
+        if (cells != oldCells)
+        {
+            removeFromCells(edge, oldCells);
+            insertIntoCells(edge, cells);
+        }
+
+        m_rectOfEdge[edge] = rect;
+        if (!m_boundingRect.contains(rect))
+        {
+            prepareGeometryChange();
+            m_boundingRect |= rect;
+        }
+
+        update(oldRect);
+    }
+
+    update(rect);
+}
+
+void EdgeLayer::clear()
+{
+    prepareGeometryChange();
+    m_cells.clear();
+    m_oversizedEdges.clear();
+    m_rectOfEdge.clear();
+    m_boundingRect = QRectF();
+}
+
+bool EdgeLayer::contains(Edge *edge) const
+{
+    return m_rectOfEdge.contains(edge);
+}
+
+int EdgeLayer::edgeCount() const
+{
+    return m_rectOfEdge.size();
+}
+
+QList<Edge *> EdgeLayer::edgesIn(const QRectF &rect) const
+{
+    QList<Edge *> edges;
+
+    // the empty cells around the Edges are not visited
+    const QRectF area = rect & m_boundingRect;
+    if (area.isEmpty())
+        return edges;
+
+    // an Edge is in every cell its rect touches
+    QSet<Edge *> found;
+    const QRect cells = cellsOf(area);
+    for (int x = cells.left(); x <= cells.right(); x++)
+    {
+        for (int y = cells.top(); y <= cells.bottom(); y++)
+        {
+            QHash<qint64, QList<Edge *> >::const_iterator cell =
+                    m_cells.constFind(cellKey(x, y));
+            if (cell == m_cells.constEnd())
+                continue;
+
+            foreach(Edge *edge, cell.value())
+            {
+                if (found.contains(edge) ||
+                    !m_rectOfEdge.value(edge).intersects(area))
+                    continue;
+
+                found.insert(edge);
+                edges.append(edge);
+            }
+        }
+    }
+
+    foreach(Edge *edge, m_oversizedEdges)
+        if (m_rectOfEdge.value(edge).intersects(area))
+            edges.append(edge);
+
+    return edges;
+}
+
+QRectF EdgeLayer::boundingRect() const
+{
+    return m_boundingRect;
+}
+
+// one drawLines() and one drawPath() per look, the Edges of a look are
+// next to each other after the sort
+void EdgeLayer::paint(QPainter *painter,
+                      const QStyleOptionGraphicsItem *option,
+                      QWidget *widget)
+{
+    Q_UNUSED(widget);
+
+    QList<Edge *> edges = edgesIn(option->exposedRect);
+    qSort(edges.begin(), edges.end(), lessByLook);
+
+    QVector<QLineF> lines;
+    QPainterPath arrows;
+    arrows.setFillRule(Qt::WindingFill);
+    for (int i = 0; i < edges.size(); i++)
+    {
+        const Edge *edge = edges[i];
+        if (!edge->overlaps())
+        {
+            lines.append(edge->line());
+            if (!edge->arrow().isEmpty())
+            {
+                arrows.addPolygon(edge->arrow());
+                arrows.closeSubpath();
+            }
+        }
+
+        // the last Edge of its look draws them
+        if (i + 1 < edges.size() && sameLook(edge, edges[i + 1]))
+            continue;
+
+        if (!lines.isEmpty())
+        {
+            painter->setPen(edge->linePen());
+            painter->drawLines(lines);
+            lines.clear();
+        }
+
+        if (!arrows.isEmpty())
+        {
+            painter->setPen(edge->arrowPen());
+            painter->setBrush(edge->color());
+            painter->drawPath(arrows);
+            arrows = QPainterPath();
+            arrows.setFillRule(Qt::WindingFill);
+        }
+    }
+}
+
+QRect EdgeLayer::cellsOf(const QRectF &rect) const
+{
+    return QRect(QPoint(int(floor(rect.left() / m_cellSize)),
+                        int(floor(rect.top() / m_cellSize))),
+                 QPoint(int(floor(rect.right() / m_cellSize)),
+                        int(floor(rect.bottom() / m_cellSize))));
+}
+
+bool EdgeLayer::isOversized(const QRect &cells)
+{
+    return qint64(cells.width()) * cells.height() > m_maxEdgeCells;
+}
+
+void EdgeLayer::insertIntoCells(Edge *edge, const QRect &cells)
+{
+    if (isOversized(cells))
+    {
+        m_oversizedEdges.insert(edge);
+        return;
+    }
+
+    for (int x = cells.left(); x <= cells.right(); x++)
+        for (int y = cells.top(); y <= cells.bottom(); y++)
+            m_cells[cellKey(x, y)].append(edge);
+}
+
+void EdgeLayer::removeFromCells(Edge *edge, const QRect &cells)
+{
+    if (isOversized(cells))
+    {
+        m_oversizedEdges.remove(edge);
+        return;
+    }
+
+    for (int x = cells.left(); x <= cells.right(); x++)
+    {
+        for (int y = cells.top(); y <= cells.bottom(); y++)
+        {
+            QHash<qint64, QList<Edge *> >::iterator cell =
+                    m_cells.find(cellKey(x, y));
+            if (cell == m_cells.end())
+                continue;
+
+            cell.value().removeOne(edge);
+            if (cell.value().isEmpty())
+                m_cells.erase(cell);
+        }
+    }
+}
+
+qint64 EdgeLayer::cellKey(const int &x, const int &y)
+{
+    return (qint64(x) << 32) | quint32(y);
+}
+
+bool EdgeLayer::lessByLook(const Edge *a, const Edge *b)
+{
+    if (a->color().rgba() != b->color().rgba())
+        return a->color().rgba() < b->color().rgba();
+
+    if (a->width() != b->width())
+        return a->width() < b->width();
+
+    return a->secondary() < b->secondary();
+}
+
+bool EdgeLayer::sameLook(const Edge *a, const Edge *b)
+{
+    return a->color().rgba() == b->color().rgba() &&
+           a->width() == b->width() &&
+           a->secondary() == b->secondary();
+}
@@ -1,16 +1,46 @@
 #include "include/graphwidget.h"
 
-#include <QtXml>
+#include <QFile>
+#include <QScopedPointer>
 #include <QColorDialog>
 #include <QApplication>
 #include <QScrollBar>
 #include <QUndoCommand>
+#include <QtConcurrentRun>
+#include <QElapsedTimer>
+#include <QtConcurrentMap>
+#include <QFontDatabase>
+#include <qmath.h>
+#include <QTextDocument>
+#include <QSvgGenerator>
+#include <QFileInfo>
+#include <QSet>
 
 #include "include/commands.h"
+#include "include/mapreader.h"
+#include "include/mapwriter.h"
+#include "include/pngwriter.h"
+#include "include/scenesnapshot.h"
+
+#include <string.h>
+
+const int GraphLogic::m_loadBatchTime = 8;
+const int GraphLogic::m_loadChunkSize = 4096;
+const int GraphLogic::m_sceneDpi = 96;
+const qint64 GraphLogic::m_exportBandMemory = 64 * 1024 * 1024;
+const int GraphLogic::m_exportTileSize = 512;
+const int GraphLogic::m_exportMargin = 20;
+const int GraphLogic::m_bspIndexItems = 2000;
+const int GraphLogic::m_bulkDragNodes = 200;
+const int GraphLogic::m_edgeLayerEdges = 1000;
 
 GraphLogic::GraphLogic(GraphWidget *parent)
     : QObject(parent)
     , m_graphWidget(parent)
+    , m_sceneNodeCount(0)
+    , m_sceneEdgeCount(0)
+    , m_subtreeIndex(&m_nodeList)
+    , m_nextNodeId(0)
     , m_activeNode(0)
     , m_showingNodeNumbers(false)
     , m_hintNumber("")
@@ -18,7 +48,30 @@ GraphLogic::GraphLogic(GraphWidget *parent)
     , m_editingNode(false)
     , m_edgeAdding(false)
     , m_edgeDeleting(false)
+    , m_undoStack(0)
+    , m_adjustRequests(0)
+    , m_adjustRuns(0)
+    , m_dragging(false)
+    , m_dragSubtree(false)
+    , m_readingFile(false)
+    , m_journalMode(false)
+    , m_savingGeneration(0)
+    , m_mapGeneration(0)
+    , m_pendingSaveGeneration(0)
+    , m_loading(false)
+    , m_loadedNodeCount(0)
+    , m_loadedEdgeCount(0)
 {
+    connect(&m_saveWatcher, SIGNAL(finished()),
+            this, SLOT(backgroundSaveFinished()));
+
+    connect(&m_loadWatcher, SIGNAL(finished()), this, SLOT(loadPrepared()));
+    m_loadTimer.setSingleShot(true);
+    connect(&m_loadTimer, SIGNAL(timeout()), this, SLOT(loadBatch()));
+
+    m_adjustTimer.setSingleShot(true);
+    connect(&m_adjustTimer, SIGNAL(timeout()), this, SLOT(flushAdjusts()));
+
     m_memberMap.insert(std::pair<int, void(GraphLogic::*)()>
                        (Qt::Key_Insert, &GraphLogic::insertNode));
     m_memberMap.insert(std::pair<int, void(GraphLogic::*)()>
@@ -37,277 +90,1690 @@ GraphLogic::GraphLogic(GraphWidget *parent)
     m_memberMap.insert(std::pair<int, void(GraphLogic::*)()>
                        (Qt::Key_F, &GraphLogic::hintMode));
 
-    m_memberMap.insert(std::pair<int, void(GraphLogic::*)()>
-                       (Qt::Key_Up, &GraphLogic::moveNodeUp));
-    m_memberMap.insert(std::pair<int, void(GraphLogic::*)()>
-                       (Qt::Key_Down, &GraphLogic::moveNodeDown));
-    m_memberMap.insert(std::pair<int, void(GraphLogic::*)()>
-                       (Qt::Key_Left, &GraphLogic::moveNodeLeft));
-    m_memberMap.insert(std::pair<int, void(GraphLogic::*)()>
-                       (Qt::Key_Right, &GraphLogic::moveNodeRight));
+    m_memberMap.insert(std::pair<int, void(GraphLogic::*)()>
+                       (Qt::Key_Up, &GraphLogic::moveNodeUp));
+    m_memberMap.insert(std::pair<int, void(GraphLogic::*)()>
+                       (Qt::Key_Down, &GraphLogic::moveNodeDown));
+    m_memberMap.insert(std::pair<int, void(GraphLogic::*)()>
+                       (Qt::Key_Left, &GraphLogic::moveNodeLeft));
+    m_memberMap.insert(std::pair<int, void(GraphLogic::*)()>
+                       (Qt::Key_Right, &GraphLogic::moveNodeRight));
+
+    m_memberMap.insert(std::pair<int, void(GraphLogic::*)()>
+                       (Qt::Key_Backspace, &GraphLogic::delNumber));
+    m_memberMap.insert(std::pair<int, void(GraphLogic::*)()>
+                       (Qt::Key_Return, &GraphLogic::applyNumber));
+    m_memberMap.insert(std::pair<int, void(GraphLogic::*)()>
+                       (Qt::Key_Enter, &GraphLogic::applyNumber));
+}
+
+GraphLogic::~GraphLogic()
+{
+    // the last changes must reach the disk before the application exits
+    m_saveWatcher.waitForFinished();
+    if (!m_pendingSaveFileName.isEmpty())
+        MapWriter::write(m_pendingSaveFileName, m_pendingSave);
+
+    m_loadWatcher.waitForFinished();
+    if (m_loadWatcher.future().resultCount())
+        qDeleteAll(m_loadWatcher.result().m_documents);
+
+    qDeleteAll(m_loadingMap.m_documents);
+
+    // the scene may delete the edges after this
+    foreach(Edge *edge, m_adjustEdges)
+        edge->setAdjustPending(false);
+
+    if (m_nodeShadow && !m_nodeShadow->scene())
+        delete m_nodeShadow;
+}
+
+GraphWidget *GraphLogic::graphWidget() const
+{
+    return m_graphWidget;
+}
+
+void GraphLogic::setUndoStack(QUndoStack *stack)
+{
+    m_undoStack = stack;
+}
+
+bool GraphLogic::processKeyEvent(QKeyEvent *event)
+{
+    if (event->key() == Qt::Key_Escape)
+    {
+        nodeLostFocus();
+        return true;
+    }
+
+    if (m_editingNode)
+    {
+        m_activeNode->keyPressEvent(event);
+        return true;
+    }
+
+    if (event->key() == Qt::Key_Plus &&
+        event->modifiers() & Qt::ControlModifier)
+    {
+        scaleUp();
+        return true;
+    }
+    if (event->key() == Qt::Key_Minus &&
+        event->modifiers() & Qt::ControlModifier)
+    {
+        scaleDown();
+        return true;
+    }
+
+    if (m_showingNodeNumbers &&
+            event->key() >= Qt::Key_0 && event->key() <= Qt::Key_9)
+    {
+        /// @todo remove magic number
+        appendNumber(event->key()-48);
+        return true;
+    }
+
+    if (m_memberMap.find(event->key()) != m_memberMap.end())
+    {
+        (this->*m_memberMap[event->key()])();
+        return true;
+    }
+
+    return false;
+}
+
+void GraphLogic::addFirstNode()
+{
+    Node *node = nodeFactory();
+    m_graphWidget->scene()->addItem(node);
+    m_nodeList.append(node);
+    node->setHtml(
+                QString("<img src=:/qtmindmap.svg width=50 height=50></img>"));
+
+    m_activeNode = m_nodeList.first();
+    m_activeNode->setBorder();
+}
+
+void GraphLogic::removeAllNodes()
+{
+    m_subtreeIndex.invalidate();
+    m_contentRect = QRectF();
+
+    // the items are deleted one by one, an index would be updated for each
+    m_readingFile = true;
+    updateItemIndex();
+
+    // the pending edges are deleted with their nodes
+    foreach(Edge *edge, m_adjustEdges)
+        edge->setAdjustPending(false);
+
+    m_adjustEdges.clear();
+    m_adjustTimer.stop();
+
+    foreach(Node *node, m_nodeList)
+        delete node;
+
+    m_nodeList.clear();
+    m_readingFile = false;
+    if (m_edgeLayer)
+        m_edgeLayer->clear();
+
+    m_dragging = false;
+    m_dragNodes.clear();
+    m_nextNodeId = 0;
+    m_activeNode = 0;
+    m_hintNode = 0;
+
+    m_snapshotFileName.clear();
+    m_snapshotStamp.clear();
+    m_editedNodes.clear();
+
+    // a save of the previous map must not touch the journal state
+    m_mapGeneration++;
+
+    // stops a running load, its parse result is dropped when it arrives
+    m_loadTimer.stop();
+    m_loading = false;
+    qDeleteAll(m_loadingMap.m_documents);
+    m_loadingMap = LoadingMap();
+    m_loadedNodes.clear();
+    updateItemIndex();
+    m_graphWidget->resetCanvas();
+}
+
+bool GraphLogic::readContentFromFile(const QString &fileName)
+{
+    QScopedPointer<MapReader> reader(MapReader::open(fileName));
+    if (!reader)
+    {
+        emit notification(tr("Couldn't read file."));
+        return false;
+    }
+
+    // the index is built once the whole map is in the scene
+    m_readingFile = true;
+    updateItemIndex();
+
+    // Nodes and Edges are created as their records arrive, there is no
+    // document of the whole map next to the scene.
+    // Nodes by their id, edges are resolved through it
+    QHash<int, Node *> nodes;
+
+    MapReader::TokenType token;
+    while ((token = reader->readNext()) != MapReader::EndOfMap &&
+           !reader->hasError())
+    {
+        if (token == MapReader::NodeRecord)
+        {
+            if (nodes.contains(reader->node().m_id))
+            {
+                reader->raiseError(tr("Duplicated node id: %1")
+                                   .arg(reader->node().m_id));
+                break;
+            }
+
+            nodes.insert(reader->node().m_id, createNode(reader->node()));
+        }
+        else
+        {
+            Node *source = nodes.value(reader->edge().m_source, 0);
+            Node *destination = nodes.value(reader->edge().m_destination, 0);
+            if (!source || !destination)
+            {
+                reader->raiseError(tr("Edge refers to a non-existent node."));
+                break;
+            }
+
+            createEdge(reader->edge(), source, destination);
+        }
+    }
+
+    if (!reader->hasError() && m_nodeList.isEmpty())
+        reader->raiseError(tr("The map has no nodes."));
+
+    if (reader->hasError())
+    {
+        emit notification(tr("Couldn't parse file: %1")
+                          .arg(reader->errorString()));
+        removeAllNodes();
+        return false;
+    }
+
+    m_snapshotFileName = fileName;
+    m_snapshotStamp = Journal(fileName).mapStamp();
+
+    // changes saved after the map file was written
+    Journal journal(fileName);
+    if (journal.exists())
+    {
+        if (!journal.belongsToMap())
+        {
+            emit notification(
+                    tr("The journal was written for another version of the "
+                       "map, ignored."));
+        }
+        else if (!replayJournal(journal, nodes))
+        {
+            emit notification(tr("Couldn't replay the whole journal."));
+        }
+    }
+
+    m_readingFile = false;
+    updateItemIndex();
+    updateEdgeLayer();
+
+    // test the first node the active one
+    m_activeNode = m_nodeList.first();
+    m_activeNode->setBorder();
+    m_activeNode->setFocus();
+
+    m_graphWidget->show();
+    return true;
+}
+
+void GraphLogic::readContentInBackground(const QString &fileName)
+{
+    removeAllNodes();
+
+    // the documents of an abandoned load are not needed
+    m_loadWatcher.waitForFinished();
+    if (m_loadWatcher.future().resultCount())
+        qDeleteAll(m_loadWatcher.result().m_documents);
+
+    m_loading = true;
+    m_loadingFileName = fileName;
+    updateItemIndex();
+    m_loadWatcher.setFuture(QtConcurrent::run(&GraphLogic::prepareMap,
+                                              fileName));
+}
+
+bool GraphLogic::isLoading() const
+{
+    return m_loading;
+}
+
+void GraphLogic::cancelLoading()
+{
+    if (!m_loading)
+        return;
+
+    removeAllNodes();
+    emit notification(tr("Opening canceled."));
+    emit loadFinished(false);
+}
+
+GraphLogic::LoadingMap GraphLogic::prepareMap(const QString &fileName)
+{
+    LoadingMap loading;
+    loading.m_maxId = -1;
+    loading.m_nodeCount = 0;
+    loading.m_edgeCount = 0;
+
+    // the order needs the whole map, it is read at once
+    MapData map;
+    loading.m_error = MapReader::read(fileName, &map);
+    if (!loading.m_error.isEmpty())
+        return loading;
+
+    // the user can edit the first Nodes while the rest is loading, so the
+    // saved changes are applied here and their new ids are reserved too
+    Journal journal(fileName);
+    if (journal.exists())
+    {
+        if (!journal.belongsToMap())
+            loading.m_journalError =
+                    tr("The journal was written for another version of the "
+                       "map, ignored.");
+        else if (!replayJournal(journal, &map))
+            loading.m_journalError = tr("Couldn't replay the whole journal.");
+    }
+
+    const QVector<NodeData> &nodes = map.m_nodes;
+    const QVector<EdgeData> &edges = map.m_edges;
+    loading.m_nodeCount = nodes.size();
+    loading.m_edgeCount = edges.size();
+
+    QHash<int, int> indexOfId;
+    indexOfId.reserve(nodes.size());
+    for (int i = 0; i < nodes.size(); i++)
+    {
+        indexOfId.insert(nodes[i].m_id, i);
+        loading.m_maxId = qMax(loading.m_maxId, nodes[i].m_id);
+    }
+
+    QVector<QVector<int> > neighbours(nodes.size());
+    foreach(const EdgeData &edge, edges)
+    {
+        int source = indexOfId.value(edge.m_source);
+        int destination = indexOfId.value(edge.m_destination);
+        neighbours[source].append(destination);
+        neighbours[destination].append(source);
+    }
+
+    // breadth first from the base node, the unreachable ones at the end
+    QVector<int> position(nodes.size(), -1);
+    QVector<int> nodeOrder;
+    nodeOrder.reserve(nodes.size());
+    for (int start = 0; start < nodes.size(); start++)
+    {
+        if (position[start] != -1)
+            continue;
+
+        position[start] = nodeOrder.size();
+        nodeOrder.append(start);
+        for (int i = position[start]; i < nodeOrder.size(); i++)
+            foreach(int next, neighbours[nodeOrder[i]])
+                if (position[next] == -1)
+                {
+                    position[next] = nodeOrder.size();
+                    nodeOrder.append(next);
+                }
+    }
+
+    // an edge is added with its later end node, bucket sort by that
+    QVector<int> bucketStart(nodes.size() + 1, 0);
+    QVector<int> ready(edges.size());
+    for (int i = 0; i < edges.size(); i++)
+    {
+        ready[i] = qMax(position[indexOfId.value(edges[i].m_source)],
+                        position[indexOfId.value(edges[i].m_destination)]);
+        bucketStart[ready[i] + 1]++;
+    }
+
+    for (int i = 0; i < nodes.size(); i++)
+        bucketStart[i + 1] += bucketStart[i];
+
+    QVector<int> edgeOrder(edges.size());
+    loading.m_edgeReady.resize(edges.size());
+    for (int i = 0; i < edges.size(); i++)
+    {
+        int slot = bucketStart[ready[i]]++;
+        edgeOrder[slot] = i;
+        loading.m_edgeReady[slot] = ready[i];
+    }
+
+    for (int i = 0; i < nodeOrder.size(); i += m_loadChunkSize)
+    {
+        QVector<NodeData> chunk;
+        chunk.reserve(qMin(m_loadChunkSize, nodeOrder.size() - i));
+        for (int j = i; j < nodeOrder.size() && j < i + m_loadChunkSize; j++)
+            chunk.append(nodes[nodeOrder[j]]);
+
+        loading.m_nodeChunks.append(chunk);
+    }
+
+    for (int i = 0; i < edgeOrder.size(); i += m_loadChunkSize)
+    {
+        QVector<EdgeData> chunk;
+        chunk.reserve(qMin(m_loadChunkSize, edgeOrder.size() - i));
+        for (int j = i; j < edgeOrder.size() && j < i + m_loadChunkSize; j++)
+            chunk.append(edges[edgeOrder[j]]);
+
+        loading.m_edgeChunks.append(chunk);
+    }
+
+    // the chunks hold the only copy from now on
+    map = MapData();
+
+    // parsing and laying out the html is the bulk of the work,
+    // it runs on all the cores
+    if (QFontDatabase::supportsThreadedFontRendering())
+        foreach(const QVector<NodeData> &chunk, loading.m_nodeChunks)
+            loading.m_documents += QtConcurrent::blockingMapped<
+                    QList<QTextDocument *> >(chunk,
+                                             &GraphLogic::layoutDocument);
+
+    return loading;
+}
+
+QTextDocument *GraphLogic::layoutDocument(const NodeData &data)
+{
+    QTextDocument *document = new QTextDocument;
+    Node::setDocumentContent(document, data.m_contentType, data.m_content);
+
+    // the size is known only after the whole document is laid out
+    document->size();
+
+    document->moveToThread(QCoreApplication::instance()->thread());
+    return document;
+}
+
+void GraphLogic::loadPrepared()
+{
+    LoadingMap loading = m_loadWatcher.result();
+    m_loadWatcher.setFuture(QFuture<LoadingMap>());
+
+    // canceled meanwhile
+    if (!m_loading)
+    {
+        qDeleteAll(loading.m_documents);
+        return;
+    }
+
+    m_loadingMap = loading;
+    if (!m_loadingMap.m_error.isEmpty())
+    {
+        emit notification(m_loadingMap.m_error);
+        removeAllNodes();
+        emit loadFinished(false);
+        return;
+    }
+
+    if (!m_loadingMap.m_journalError.isEmpty())
+        emit notification(m_loadingMap.m_journalError);
+
+    // nodes inserted during the load must not take an id of the file
+    m_nextNodeId = qMax(m_nextNodeId, m_loadingMap.m_maxId + 1);
+    m_loadedNodes.reserve(m_loadingMap.m_nodeCount);
+    m_loadedNodeCount = 0;
+    m_loadedEdgeCount = 0;
+
+    loadBatch();
+}
+
+void GraphLogic::loadBatch()
+{
+    if (!m_loading)
+        return;
+
+    const int nodeCount = m_loadingMap.m_nodeCount;
+    const int edgeCount = m_loadingMap.m_edgeCount;
+
+    // keep the event loop responsive, the user can work on the nodes
+    // which are already in the scene
+    QElapsedTimer timer;
+    timer.start();
+    while (m_loadedNodeCount < nodeCount &&
+           timer.elapsed() < m_loadBatchTime)
+    {
+        QTextDocument *document = 0;
+        if (!m_loadingMap.m_documents.isEmpty())
+        {
+            document = m_loadingMap.m_documents[m_loadedNodeCount];
+            m_loadingMap.m_documents[m_loadedNodeCount] = 0;
+        }
+
+        const NodeData &data = m_loadingMap.m_nodeChunks.first().at(
+                    m_loadedNodeCount % m_loadChunkSize);
+        m_loadedNodes.insert(data.m_id, createNode(data, document));
+
+        while (m_loadedEdgeCount < edgeCount &&
+               m_loadingMap.m_edgeReady[m_loadedEdgeCount] <=
+                    m_loadedNodeCount)
+        {
+            const EdgeData &edge = m_loadingMap.m_edgeChunks.first().at(
+                        m_loadedEdgeCount % m_loadChunkSize);
+            Node *source = m_loadedNodes.value(edge.m_source);
+            Node *destination = m_loadedNodes.value(edge.m_destination);
+
+            // the user may have removed an end of it already
+            if (source && source->scene() &&
+                destination && destination->scene())
+                createEdge(edge, source, destination);
+
+            // an added chunk is freed at once
+            if (++m_loadedEdgeCount % m_loadChunkSize == 0)
+                m_loadingMap.m_edgeChunks.removeFirst();
+        }
+
+        if (++m_loadedNodeCount % m_loadChunkSize == 0)
+            m_loadingMap.m_nodeChunks.removeFirst();
+    }
+
+    // the base node is the first one
+    if (!m_activeNode && !m_nodeList.isEmpty())
+    {
+        m_activeNode = m_nodeList.first();
+        m_activeNode->setBorder();
+        m_activeNode->setFocus();
+        m_graphWidget->show();
+    }
+
+    emit loadProgress(m_loadedNodeCount, nodeCount);
+
+    if (m_loadedNodeCount < nodeCount)
+    {
+        m_loadTimer.start(0);
+        return;
+    }
+
+    finishLoading();
+}
+
+void GraphLogic::finishLoading()
+{
+    m_snapshotFileName = m_loadingFileName;
+    m_snapshotStamp = Journal(m_loadingFileName).mapStamp();
+
+    m_loading = false;
+    m_loadingMap = LoadingMap();
+    m_loadedNodes.clear();
+
+    updateItemIndex();
+    updateEdgeLayer();
+    emit loadFinished(true);
+}
+
+void GraphLogic::writeContentToFile(const QString &fileName)
+{
+    // a background save of the same file would overwrite this one
+    m_saveWatcher.waitForFinished();
+
+    QString error = MapWriter::write(fileName, snapshot());
+    if (!error.isEmpty())
+    {
+        emit notification(error);
+        return;
+    }
+
+    savedSnapshot(fileName);
+    m_editedNodes.clear();
+
+    // show a statusBar message to the user
+    emit notification(tr("Saved."));
+}
+
+void GraphLogic::writeContentInBackground(const QString &fileName)
+{
+    // the copy is taken now, the scene can change during the save
+    MapData map = snapshot();
+    if (map.m_nodes.isEmpty())
+    {
+        emit notification(tr("The map has no nodes, it was not saved."));
+        return;
+    }
+
+    // the edited Nodes are forgotten only when the save has succeeded
+    if (m_saveWatcher.isRunning())
+    {
+        m_pendingSaveFileName = fileName;
+        m_pendingSave = map;
+        m_pendingSaveGeneration = m_mapGeneration;
+        foreach(Node *node, m_editedNodes)
+            if (!m_pendingEditedNodes.contains(node))
+                m_pendingEditedNodes.append(node);
+        m_editedNodes.clear();
+        return;
+    }
+
+    m_savingFileName = fileName;
+    m_savingGeneration = m_mapGeneration;
+    m_savingEditedNodes = m_editedNodes;
+    m_editedNodes.clear();
+    m_saveWatcher.setFuture(QtConcurrent::run(&MapWriter::write,
+                                              fileName,
+                                              map));
+}
+
+bool GraphLogic::isSaving() const
+{
+    return m_saveWatcher.isRunning();
+}
+
+void GraphLogic::backgroundSaveFinished()
+{
+    QString error = m_saveWatcher.result();
+    if (!error.isEmpty())
+    {
+        // the edits of the failed save are still to be written
+        if (m_savingGeneration == m_mapGeneration)
+            foreach(Node *node, m_savingEditedNodes)
+                if (node && !m_editedNodes.contains(node))
+                    m_editedNodes.append(node);
+
+        emit notification(error);
+        emit contentChanged();
+    }
+    else
+    {
+        if (m_savingGeneration == m_mapGeneration)
+            savedSnapshot(m_savingFileName);
+
+        // show a statusBar message to the user
+        emit notification(tr("Saved."));
+    }
+    m_savingEditedNodes.clear();
+
+    if (m_pendingSaveFileName.isEmpty())
+        return;
+
+    // the queued save belongs to the map it was taken from
+    m_savingFileName = m_pendingSaveFileName;
+    m_savingGeneration = m_pendingSaveGeneration;
+    m_savingEditedNodes = m_pendingEditedNodes;
+    m_saveWatcher.setFuture(QtConcurrent::run(&MapWriter::write,
+                                              m_pendingSaveFileName,
+                                              m_pendingSave));
+    m_pendingSaveFileName.clear();
+    m_pendingSave = MapData();
+    m_pendingEditedNodes.clear();
+}
+
+void GraphLogic::savedSnapshot(const QString &fileName)
+{
+    Journal journal(fileName);
+    journal.remove();
+    m_snapshotFileName = fileName;
+    m_snapshotStamp = journal.mapStamp();
+}
+
+void GraphLogic::writeChangesToFile(const QString &fileName)
+{
+    // the journal can continue only the map file the scene was
+    // loaded from or written to the last time
+    Journal journal(fileName);
+    if (!m_journalMode || !m_undoStack || m_saveWatcher.isRunning() ||
+        fileName != m_snapshotFileName ||
+        journal.mapStamp() != m_snapshotStamp ||
+        (journal.exists() && !journal.belongsToMap()) ||
+        journal.needsCompaction())
+    {
+        writeContentInBackground(fileName);
+        return;
+    }
+
+    // the commands done since the last save, the stack is cleared then
+    QByteArray batch;
+    QDataStream stream(&batch, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_6);
+    for (int i = 0; i < m_undoStack->index(); i++)
+        static_cast<const BaseUndoClass *>(m_undoStack->command(i))->
+                writeJournal(stream);
+
+    // editing the content of a Node is not an undo command (yet)
+    foreach(Node *node, m_editedNodes)
+        if (node && node->scene())
+        {
+            NodeData::ContentType type;
+            QString content = node->content(&type);
+            stream << quint8(Journal::NodeContentRecord)
+                   << qint32(node->id())
+                   << quint8(type)
+                   << content;
+        }
+
+    if (!batch.isEmpty() && !journal.append(batch))
+    {
+        emit notification(tr("Couldn't write the journal."));
+        return;
+    }
+
+    m_editedNodes.clear();
+    emit notification(tr("Saved."));
+}
+
+/** Renders a tile of a band of the exported image into its own QImage
+  * on a worker thread and copies it to its place in the band.
+  * Tiles of a band don't overlap, they write disjoint parts of it.
+  */
+struct TileRenderer
+{
+    typedef void result_type;
+
+    const SceneSnapshot *m_snapshot;
+    QRectF m_rect;      // exported part of the scene
+    uchar *m_band;
+    int m_bytesPerLine;
+    int m_bandTop;      // in the whole image
+    qreal m_scale;
+
+    void operator()(const QRect &tile) const
+    {
+        QImage image(tile.size(), QImage::Format_RGB32);
+        image.fill(GraphWidget::m_paperColor.rgb());
+
+        // whole pixel offset of the tile, the tiles join seamlessly
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.translate(-tile.left(), -m_bandTop - tile.top());
+        painter.scale(m_scale, m_scale);
+        painter.translate(-m_rect.topLeft());
+        m_snapshot->render(&painter,
+                           QRectF(m_rect.left() + tile.left() / m_scale,
+                                  m_rect.top() + (m_bandTop + tile.top()) /
+                                        m_scale,
+                                  tile.width() / m_scale,
+                                  tile.height() / m_scale));
+        painter.end();
+
+        for (int row = 0; row < tile.height(); row++)
+            memcpy(m_band + (tile.top() + row) * m_bytesPerLine +
+                        tile.left() * 4,
+                   image.constScanLine(row),
+                   tile.width() * 4);
+    }
+};
+
+bool GraphLogic::writeContentToPngFile(const QString &fileName,
+                                       const int &dpi)
+{
+    flushAdjusts();
+
+    QGraphicsScene *scene = m_graphWidget->scene();
+    const QRectF rect = exportRect();
+    const qreal scale = qreal(dpi) / m_sceneDpi;
+    const int width = qCeil(rect.width() * scale);
+    const int height = qCeil(rect.height() * scale);
+
+    // the image is rendered in bands of whole rows, as high as the memory
+    // budget allows, and streamed to the encoder; at least one row
+    const int bandHeight = qBound(
+                1, int(m_exportBandMemory / (qint64(width) * 4)), height);
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        emit notification(tr("Couldn't open file to write."));
+        return false;
+    }
+
+    // the tiles of a band are rendered on the thread pool from a copy of
+    // the scene, the text needs fonts usable outside the GUI thread
+    QScopedPointer<SceneSnapshot> snapshot;
+    if (QFontDatabase::supportsThreadedFontRendering())
+        snapshot.reset(new SceneSnapshot(scene, scale));
+
+    QImage band(width, bandHeight, QImage::Format_RGB32);
+    PngWriter png(&file, width, height, dpi);
+    bool ok = !band.isNull() && png.begin();
+    for (int y = 0; ok && y < height; y += bandHeight)
+    {
+        const int rows = qMin(bandHeight, height - y);
+
+        if (snapshot)
+        {
+            QList<QRect> tiles;
+            for (int top = 0; top < rows; top += m_exportTileSize)
+                for (int left = 0; left < width; left += m_exportTileSize)
+                    tiles.append(QRect(left, top,
+                                       qMin(m_exportTileSize, width - left),
+                                       qMin(m_exportTileSize, rows - top)));
+
+            TileRenderer renderer;
+            renderer.m_snapshot = snapshot.data();
+            renderer.m_rect = rect;
+            renderer.m_band = band.bits();
+            renderer.m_bytesPerLine = band.bytesPerLine();
+            renderer.m_bandTop = y;
+            renderer.m_scale = scale;
+            QtConcurrent::blockingMap(tiles, renderer);
+        }
+        else
+        {
+            band.fill(GraphWidget::m_paperColor.rgb());
+
+            QPainter painter(&band);
+            painter.setRenderHint(QPainter::Antialiasing);
+            painter.translate(0, -y);
+            painter.scale(scale, scale);
+            painter.translate(-rect.topLeft());
+
+            QRectF source(rect.left(), rect.top() + y / scale,
+                          rect.width(), rows / scale);
+            scene->render(&painter, source, source);
+            painter.end();
+        }
+
+        for (int row = 0; ok && row < rows; row++)
+            ok = png.writeRow(
+                    reinterpret_cast<const quint32 *>(band.constScanLine(row)));
+    }
+
+    ok = ok && png.end();
+    file.close();
+    if (!ok || file.error() != QFile::NoError)
+    {
+        emit notification(tr("Couldn't export the image."));
+        return false;
+    }
+
+    // show a statusBar message to the user
+    emit notification(tr("MindMap exported as ") + fileName);
+    return true;
+}
+
+bool GraphLogic::writeContentToSvgFile(const QString &fileName)
+{
+    flushAdjusts();
+
+    QGraphicsScene *scene = m_graphWidget->scene();
+    const QRectF rect = exportRect();
+
+    // the generator only warns if it can't write, its device tells it
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        emit notification(tr("Couldn't open file to write."));
+        return false;
+    }
+
+    QSvgGenerator svg;
+    svg.setOutputDevice(&file);
+    svg.setSize(rect.size().toSize());
+    svg.setViewBox(QRectF(QPointF(0, 0), rect.size()));
+    svg.setResolution(m_sceneDpi);
+    svg.setTitle(QFileInfo(fileName).completeBaseName());
+
+    QPainter painter;
+    if (!painter.begin(&svg))
+    {
+        file.remove();
+        emit notification(tr("Couldn't open file to write."));
+        return false;
+    }
+
+    painter.fillRect(QRectF(QPointF(0, 0), rect.size()),
+                     GraphWidget::m_paperColor);
+    scene->render(&painter, QRectF(QPointF(0, 0), rect.size()), rect);
+    painter.end();
+
+    file.close();
+    if (file.error() != QFile::NoError)
+    {
+        file.remove();
+        emit notification(tr("Couldn't export the image."));
+        return false;
+    }
+
+    // show a statusBar message to the user
+    emit notification(tr("MindMap exported as ") + fileName);
+    return true;
+}
+
+QRectF GraphLogic::exportRect() const
+{
+    QRectF rect;
+    foreach(Node *node, m_nodeList)
+        rect |= node->sceneBoundingRect();
+
+    return rect.adjusted(-m_exportMargin, -m_exportMargin,
+                         m_exportMargin, m_exportMargin);
+}
+
+Node *GraphLogic::createNode(const NodeData &data, QTextDocument *document)
+{
+    Node *node = nodeFactory();
+    node->setId(data.m_id);
+    m_nextNodeId = qMax(m_nextNodeId, data.m_id + 1);
+
+    m_graphWidget->scene()->addItem(node);
+    m_nodeList.append(node);
+
+    // setting up the Node from the file is not a change of the content
+    node->blockSignals(true);
+    if (document)
+    {
+        node->setDocument(document);
+    }
+    else
+    {
+        node->setContent(data.m_contentType, data.m_content);
+    }
+
+    node->setPos(data.m_x, data.m_y);
+
+    // Node::setScale is relative to the current scale
+    node->setScale(data.m_scale - node->scale());
+    node->setColor(QColor::fromRgb(data.m_color));
+    node->setTextColor(QColor::fromRgb(data.m_textColor));
+    node->blockSignals(false);
+
+    return node;
+}
+
+Edge *GraphLogic::createEdge(const EdgeData &data,
+                             Node *source,
+                             Node *destination)
+{
+    Edge *edge = new Edge(source, destination);
+    source->addEdge(edge, true);
+    destination->addEdge(edge, false);
+
+    edge->setColor(QColor::fromRgb(data.m_color));
+    edge->setWidth(data.m_width);
+    edge->setSecondary(data.m_secondary);
+
+    m_graphWidget->scene()->addItem(edge);
+
+    return edge;
+}
+
+NodeData GraphLogic::nodeData(Node *node) const
+{
+    NodeData data;
+    data.m_id = node->id();
+    data.m_x = node->pos().x();
+    data.m_y = node->pos().y();
+    data.m_scale = node->scale();
+    data.m_color = node->color().rgb();
+    data.m_textColor = node->textColor().rgb();
+    data.m_content = node->content(&data.m_contentType);
+
+    return data;
+}
+
+EdgeData GraphLogic::edgeData(Edge *edge) const
+{
+    EdgeData data;
+    data.m_source = edge->sourceNode()->id();
+    data.m_destination = edge->destNode()->id();
+    data.m_color = edge->color().rgb();
+    data.m_width = edge->width();
+    data.m_secondary = edge->secondary();
+
+    return data;
+}
+
+MapData GraphLogic::snapshot() const
+{
+    MapData map;
+    map.m_nodes.reserve(m_nodeList.size());
+    foreach(Node *node, m_nodeList)
+        map.m_nodes.append(nodeData(node));
+
+    foreach(Edge *edge, allEdges())
+        map.m_edges.append(edgeData(edge));
+
+    return map;
+}
+
+bool GraphLogic::replayJournal(const Journal &journal,
+                               QHash<int, Node *> &nodes)
+{
+    foreach(QByteArray batch, journal.readBatches())
+    {
+        QDataStream stream(batch);
+        stream.setVersion(QDataStream::Qt_4_6);
+        while (!stream.atEnd())
+        {
+            quint8 type;
+            stream >> type;
+            if (!replayJournalRecord(type, stream, nodes))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+// the Nodes of the ids, false if any of them is missing
+static bool nodesOfIds(const QList<qint32> &ids,
+                       const QHash<int, Node *> &nodes,
+                       QList<Node *> &nodeList)
+{
+    foreach(qint32 id, ids)
+    {
+        Node *node = nodes.value(id, 0);
+        if (!node)
+            return false;
+
+        nodeList.append(node);
+    }
+
+    return true;
+}
+
+// does the same as the undo command which wrote the record
+bool GraphLogic::replayJournalRecord(const quint8 &type,
+                                     QDataStream &stream,
+                                     QHash<int, Node *> &nodes)
+{
+    switch (type) {
+
+    case Journal::InsertNodeRecord:
+    {
+        qint32 id, parentId;
+        double x, y, width;
+        quint32 color, textColor;
+        stream >> id >> parentId >> x >> y >> color >> textColor >> width;
+
+        Node *parent = nodes.value(parentId, 0);
+        if (stream.status() != QDataStream::Ok || !parent ||
+            nodes.contains(id))
+            return false;
+
+        NodeData nodeData;
+        nodeData.m_id = id;
+        nodeData.m_x = x;
+        nodeData.m_y = y;
+        nodeData.m_color = color;
+        nodeData.m_textColor = textColor;
+        Node *node = createNode(nodeData);
+        nodes.insert(id, node);
+
+        EdgeData edgeData;
+        edgeData.m_color = color;
+        edgeData.m_width = width;
+        createEdge(edgeData, parent, node);
+        return true;
+    }
+    case Journal::RemoveNodesRecord:
+    {
+        QList<qint32> ids;
+        QList<Node *> nodeList;
+        stream >> ids;
+        if (stream.status() != QDataStream::Ok ||
+            !nodesOfIds(ids, nodes, nodeList))
+            return false;
+
+        foreach(Node *node, nodeList)
+        {
+            nodes.remove(node->id());
+            m_nodeList.removeAll(node);
+            delete node;
+        }
+        return true;
+    }
+    case Journal::AddEdgeRecord:
+    {
+        qint32 sourceId, destinationId;
+        quint32 color;
+        double width;
+        bool secondary;
+        stream >> sourceId >> destinationId >> color >> width >> secondary;
+
+        Node *source = nodes.value(sourceId, 0);
+        Node *destination = nodes.value(destinationId, 0);
+        if (stream.status() != QDataStream::Ok || !source || !destination)
+            return false;
+
+        EdgeData edgeData;
+        edgeData.m_color = color;
+        edgeData.m_width = width;
+        edgeData.m_secondary = secondary;
+        createEdge(edgeData, source, destination);
+        return true;
+    }
+    case Journal::RemoveEdgeRecord:
+    {
+        qint32 sourceId, destinationId;
+        stream >> sourceId >> destinationId;
+
+        Node *source = nodes.value(sourceId, 0);
+        Node *destination = nodes.value(destinationId, 0);
+        if (stream.status() != QDataStream::Ok || !source || !destination ||
+            !source->isConnected(destination))
+            return false;
+
+        source->deleteEdge(destination);
+        return true;
+    }
+    case Journal::MoveRecord:
+    {
+        QList<qint32> ids;
+        QList<Node *> nodeList;
+        double x, y;
+        stream >> ids >> x >> y;
+        if (stream.status() != QDataStream::Ok ||
+            !nodesOfIds(ids, nodes, nodeList))
+            return false;
+
+        foreach(Node *node, nodeList)
+            node->moveBy(x, y);
+        return true;
+    }
+    case Journal::NodeColorRecord:
+    {
+        QList<qint32> ids;
+        QList<Node *> nodeList;
+        quint32 color;
+        stream >> ids >> color;
+        if (stream.status() != QDataStream::Ok ||
+            !nodesOfIds(ids, nodes, nodeList))
+            return false;
+
+        foreach(Node *node, nodeList)
+        {
+            node->setColor(QColor::fromRgb(color));
+            foreach (Edge * edge, node->parentEdges())
+                edge->setColor(QColor::fromRgb(color));
+
+            foreach (Edge * edge, node->secondaryEdges())
+                if (edge->destNode() == node)
+                    edge->setColor(QColor::fromRgb(color));
+        }
+        return true;
+    }
+    case Journal::NodeTextColorRecord:
+    {
+        QList<qint32> ids;
+        QList<Node *> nodeList;
+        quint32 color;
+        stream >> ids >> color;
+        if (stream.status() != QDataStream::Ok ||
+            !nodesOfIds(ids, nodes, nodeList))
+            return false;
+
+        foreach(Node *node, nodeList)
+            node->setTextColor(QColor::fromRgb(color));
+        return true;
+    }
+    case Journal::ScaleRecord:
+    {
+        QList<qint32> ids;
+        QList<Node *> nodeList;
+        double scale;
+        stream >> ids >> scale;
+        if (stream.status() != QDataStream::Ok ||
+            !nodesOfIds(ids, nodes, nodeList))
+            return false;
+
+        foreach(Node *node, nodeList)
+            node->setScale(scale);
+        return true;
+    }
+    case Journal::NodeHtmlRecord:
+    {
+        qint32 id;
+        QString html;
+        stream >> id >> html;
+
+        Node *node = nodes.value(id, 0);
+        if (stream.status() != QDataStream::Ok || !node)
+            return false;
+
+        node->setHtml(html);
+        return true;
+    }
+    case Journal::NodeContentRecord:
+    {
+        qint32 id;
+        quint8 type;
+        QString content;
+        stream >> id >> type >> content;
+
+        Node *node = nodes.value(id, 0);
+        if (stream.status() != QDataStream::Ok || !node ||
+            type > NodeData::PlainText)
+            return false;
+
+        node->setContent(NodeData::ContentType(type), content);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+// the read map while the journal is replayed on it; the removed entries
+// are only dropped from the indexes, so the order of the file is kept
+struct ReplayMap
+{
+    MapData *m_map;
+    QHash<int, int> m_nodeIndex;            // by id
+    QHash<qint64, int> m_edgeIndex;         // by the ids of the ends
+    QMultiHash<int, int> m_edgesOfNode;     // by the id of either end
+};
+
+static qint64 edgeKey(const int &source, const int &destination)
+{
+    return (qint64(source) << 32) | quint32(destination);
+}
 
-    m_memberMap.insert(std::pair<int, void(GraphLogic::*)()>
-                       (Qt::Key_Backspace, &GraphLogic::delNumber));
-    m_memberMap.insert(std::pair<int, void(GraphLogic::*)()>
-                       (Qt::Key_Return, &GraphLogic::applyNumber));
-    m_memberMap.insert(std::pair<int, void(GraphLogic::*)()>
-                       (Qt::Key_Enter, &GraphLogic::applyNumber));
+static bool isReplayedNode(const ReplayMap &replay, const int &index)
+{
+    return replay.m_nodeIndex.value(replay.m_map->m_nodes[index].m_id, -1)
+            == index;
 }
 
-GraphWidget *GraphLogic::graphWidget() const
+static bool isReplayedEdge(const ReplayMap &replay, const int &index)
 {
-    return m_graphWidget;
+    const EdgeData &edge = replay.m_map->m_edges[index];
+    return replay.m_edgeIndex.value(
+                edgeKey(edge.m_source, edge.m_destination), -1) == index;
 }
 
-void GraphLogic::setUndoStack(QUndoStack *stack)
+// a later edge between the same nodes replaces the earlier one
+static void insertReplayedEdge(ReplayMap &replay, const EdgeData &data)
 {
-    m_undoStack = stack;
+    const int index = replay.m_map->m_edges.size();
+    replay.m_map->m_edges.append(data);
+    replay.m_edgeIndex.insert(edgeKey(data.m_source, data.m_destination),
+                              index);
+    replay.m_edgesOfNode.insert(data.m_source, index);
+    replay.m_edgesOfNode.insert(data.m_destination, index);
 }
 
-bool GraphLogic::processKeyEvent(QKeyEvent *event)
+// the ids are in the map, false if any of them is missing
+static bool hasIds(const QList<qint32> &ids, const ReplayMap &replay)
 {
-    if (event->key() == Qt::Key_Escape)
+    foreach(qint32 id, ids)
+        if (!replay.m_nodeIndex.contains(id))
+            return false;
+
+    return true;
+}
+
+// the primary and secondary edges which end in one of the nodes,
+// they change their color and width with the node
+static QList<int> edgesEndingIn(const QSet<int> &ids,
+                                const ReplayMap &replay)
+{
+    QList<int> edges;
+    foreach(int id, ids)
+        foreach(int index, replay.m_edgesOfNode.values(id))
+            if (isReplayedEdge(replay, index) &&
+                replay.m_map->m_edges[index].m_destination == id)
+                edges.append(index);
+
+    return edges;
+}
+
+// does the same on the read map as GraphLogic::replayJournalRecord()
+// does on the scene
+static bool replayOnMap(const quint8 &type,
+                        QDataStream &stream,
+                        ReplayMap &replay)
+{
+    QVector<NodeData> &nodes = replay.m_map->m_nodes;
+    QVector<EdgeData> &edges = replay.m_map->m_edges;
+
+    switch (type) {
+
+    case Journal::InsertNodeRecord:
     {
-        nodeLostFocus();
+        qint32 id, parentId;
+        double x, y, width;
+        quint32 color, textColor;
+        stream >> id >> parentId >> x >> y >> color >> textColor >> width;
+
+        if (stream.status() != QDataStream::Ok ||
+            !replay.m_nodeIndex.contains(parentId) ||
+            replay.m_nodeIndex.contains(id))
+            return false;
+
+        NodeData nodeData;
+        nodeData.m_id = id;
+        nodeData.m_x = x;
+        nodeData.m_y = y;
+        nodeData.m_color = color;
+        nodeData.m_textColor = textColor;
+        replay.m_nodeIndex.insert(id, nodes.size());
+        nodes.append(nodeData);
+
+        EdgeData edgeData;
+        edgeData.m_source = parentId;
+        edgeData.m_destination = id;
+        edgeData.m_color = color;
+        if (isEdgeWidth(width))
+            edgeData.m_width = width;
+        insertReplayedEdge(replay, edgeData);
         return true;
     }
+    case Journal::RemoveNodesRecord:
+    {
+        QList<qint32> ids;
+        stream >> ids;
+        if (stream.status() != QDataStream::Ok || !hasIds(ids, replay))
+            return false;
 
-    if (m_editingNode)
+        // the edges go with the nodes
+        foreach(int id, ids.toSet())
+        {
+            foreach(int index, replay.m_edgesOfNode.values(id))
+                if (isReplayedEdge(replay, index))
+                    replay.m_edgeIndex.remove(
+                                edgeKey(edges[index].m_source,
+                                        edges[index].m_destination));
+
+            replay.m_edgesOfNode.remove(id);
+            replay.m_nodeIndex.remove(id);
+        }
+        return true;
+    }
+    case Journal::AddEdgeRecord:
     {
-        m_activeNode->keyPressEvent(event);
+        qint32 sourceId, destinationId;
+        quint32 color;
+        double width;
+        bool secondary;
+        stream >> sourceId >> destinationId >> color >> width >> secondary;
+
+        if (stream.status() != QDataStream::Ok ||
+            !replay.m_nodeIndex.contains(sourceId) ||
+            !replay.m_nodeIndex.contains(destinationId))
+            return false;
+
+        EdgeData edgeData;
+        edgeData.m_source = sourceId;
+        edgeData.m_destination = destinationId;
+        edgeData.m_color = color;
+        if (isEdgeWidth(width))
+            edgeData.m_width = width;
+        edgeData.m_secondary = secondary;
+        insertReplayedEdge(replay, edgeData);
         return true;
     }
+    case Journal::RemoveEdgeRecord:
+    {
+        qint32 sourceId, destinationId;
+        stream >> sourceId >> destinationId;
+        if (stream.status() != QDataStream::Ok)
+            return false;
+
+        // the scene does not care about the direction either
+        if (replay.m_edgeIndex.remove(edgeKey(sourceId, destinationId)) ||
+            replay.m_edgeIndex.remove(edgeKey(destinationId, sourceId)))
+            return true;
+        return false;
+    }
+    case Journal::MoveRecord:
+    {
+        QList<qint32> ids;
+        double x, y;
+        stream >> ids >> x >> y;
+        if (stream.status() != QDataStream::Ok || !hasIds(ids, replay))
+            return false;
 
-    if (event->key() == Qt::Key_Plus &&
-        event->modifiers() & Qt::ControlModifier)
+        foreach(qint32 id, ids)
+        {
+            NodeData &node = nodes[replay.m_nodeIndex.value(id)];
+            node.m_x += x;
+            node.m_y += y;
+        }
+        return true;
+    }
+    case Journal::NodeColorRecord:
     {
-        scaleUp();
+        QList<qint32> ids;
+        quint32 color;
+        stream >> ids >> color;
+        if (stream.status() != QDataStream::Ok || !hasIds(ids, replay))
+            return false;
+
+        foreach(qint32 id, ids)
+            nodes[replay.m_nodeIndex.value(id)].m_color = color;
+
+        foreach(int index, edgesEndingIn(ids.toSet(), replay))
+            edges[index].m_color = color;
         return true;
     }
-    if (event->key() == Qt::Key_Minus &&
-        event->modifiers() & Qt::ControlModifier)
+    case Journal::NodeTextColorRecord:
     {
-        scaleDown();
+        QList<qint32> ids;
+        quint32 color;
+        stream >> ids >> color;
+        if (stream.status() != QDataStream::Ok || !hasIds(ids, replay))
+            return false;
+
+        foreach(qint32 id, ids)
+            nodes[replay.m_nodeIndex.value(id)].m_textColor = color;
         return true;
     }
-
-    if (m_showingNodeNumbers &&
-            event->key() >= Qt::Key_0 && event->key() <= Qt::Key_9)
+    case Journal::ScaleRecord:
     {
-        /// @todo remove magic number
-        appendNumber(event->key()-48);
+        QList<qint32> ids;
+        double scale;
+        stream >> ids >> scale;
+        if (stream.status() != QDataStream::Ok || !hasIds(ids, replay))
+            return false;
+
+        foreach(qint32 id, ids)
+            nodes[replay.m_nodeIndex.value(id)].m_scale += scale;
+
+        foreach(int index, edgesEndingIn(ids.toSet(), replay))
+            if (isEdgeWidth(edges[index].m_width + scale))
+                edges[index].m_width += scale;
         return true;
     }
-
-    if (m_memberMap.find(event->key()) != m_memberMap.end())
+    case Journal::NodeHtmlRecord:
     {
-        (this->*m_memberMap[event->key()])();
+        qint32 id;
+        QString html;
+        stream >> id >> html;
+        if (stream.status() != QDataStream::Ok ||
+            !replay.m_nodeIndex.contains(id))
+            return false;
+
+        NodeData &node = nodes[replay.m_nodeIndex.value(id)];
+        node.m_contentType = NodeData::HtmlDocument;
+        node.m_content = html;
+        return true;
+    }
+    case Journal::NodeContentRecord:
+    {
+        qint32 id;
+        quint8 type;
+        QString content;
+        stream >> id >> type >> content;
+        if (stream.status() != QDataStream::Ok ||
+            !replay.m_nodeIndex.contains(id) || type > NodeData::PlainText)
+            return false;
+
+        NodeData &node = nodes[replay.m_nodeIndex.value(id)];
+        node.m_contentType = NodeData::ContentType(type);
+        node.m_content = content;
         return true;
     }
+    default:
+        return false;
+    }
+}
 
-    return false;
+bool GraphLogic::replayJournal(const Journal &journal, MapData *map)
+{
+    ReplayMap replay;
+    replay.m_map = map;
+    replay.m_nodeIndex.reserve(map->m_nodes.size());
+    for (int i = 0; i < map->m_nodes.size(); i++)
+        replay.m_nodeIndex.insert(map->m_nodes[i].m_id, i);
+
+    const QVector<EdgeData> edges = map->m_edges;
+    map->m_edges.clear();
+    map->m_edges.reserve(edges.size());
+    replay.m_edgeIndex.reserve(edges.size());
+    foreach(const EdgeData &edge, edges)
+        insertReplayedEdge(replay, edge);
+
+    // the records before a broken one are kept, as on the scene
+    bool replayed = true;
+    foreach(QByteArray batch, journal.readBatches())
+    {
+        QDataStream stream(batch);
+        stream.setVersion(QDataStream::Qt_4_6);
+        while (replayed && !stream.atEnd())
+        {
+            quint8 type;
+            stream >> type;
+            replayed = replayOnMap(type, stream, replay);
+        }
+
+        if (!replayed)
+            break;
+    }
+
+    MapData result;
+    result.m_nodes.reserve(replay.m_nodeIndex.size());
+    for (int i = 0; i < map->m_nodes.size(); i++)
+        if (isReplayedNode(replay, i))
+            result.m_nodes.append(map->m_nodes[i]);
+
+    result.m_edges.reserve(replay.m_edgeIndex.size());
+    for (int i = 0; i < map->m_edges.size(); i++)
+        if (isReplayedEdge(replay, i))
+            result.m_edges.append(map->m_edges[i]);
+
+    *map = result;
+    return replayed;
 }
 
-void GraphLogic::addFirstNode()
+Node * GraphLogic::nodeFactory()
 {
-    Node *node = nodeFactory();
-    m_graphWidget->scene()->addItem(node);
-    m_nodeList.append(node);
-    node->setHtml(
-                QString("<img src=:/qtmindmap.svg width=50 height=50></img>"));
+    Node *node = new Node(this);
+    node->setId(m_nextNodeId++);
 
-    m_activeNode = m_nodeList.first();
-    m_activeNode->setBorder();
+    connect(node, SIGNAL(nodeChanged()), this, SLOT(nodeChanged()));
+    connect(node, SIGNAL(nodeSelected()), this, SLOT(nodeSelected()));
+    connect(node, SIGNAL(nodeEdited()), this, SLOT(nodeEdited()));
+    connect(node, SIGNAL(nodeMoved(QGraphicsSceneMouseEvent*)),
+            this, SLOT(nodeMoved(QGraphicsSceneMouseEvent*)));
+    connect(node, SIGNAL(nodeLostFocus()), this, SLOT(nodeLostFocus()));
+
+    return node;
 }
 
-void GraphLogic::removeAllNodes()
+void GraphLogic::nodeAddedToScene(Node *node)
 {
-    foreach(Node *node, m_nodeList)
-        delete node;
+    m_sceneNodeCount++;
+    m_subtreeIndex.invalidate();
+    updateItemIndex();
+    nodeGeometryChanged(node);
+}
 
-    m_nodeList.clear();
-    m_activeNode = 0;
-    m_hintNode = 0;
+void GraphLogic::nodeRemovedFromScene(Node *node)
+{
+    if (m_nodeShadow && m_nodeShadow->node() == node)
+        m_nodeShadow->setNode(0);
+
+    m_sceneNodeCount--;
+    m_subtreeIndex.invalidate();
+    updateItemIndex();
 }
 
-bool GraphLogic::readContentFromXmlFile(const QString &fileName)
+void GraphLogic::edgeAddedToScene(Edge *edge)
 {
-    // open & parse XML file
-    QDomDocument doc("QtMindMap");
-    QFile file(fileName);
-    if (!file.open(QIODevice::ReadOnly))
-    {
-        emit notification(tr("Couldn't read file."));
-        return false;
-    }
+    m_sceneEdgeCount++;
+    updateItemIndex();
 
-    if (!doc.setContent(&file))
-    {
-        emit notification(tr("Couldn't parse XML file."));
-        file.close();
-        return false;
-    }
-    file.close();
+    // it may have been removed while an other drawing was on
+    edge->setFlag(QGraphicsItem::ItemHasNoContents, !m_edgeLayer.isNull());
+    if (m_edgeLayer)
+        m_edgeLayer->insertEdge(edge);
 
-    QDomElement docElem = doc.documentElement();
+    updateEdgeLayer();
+}
 
-    // add nodes
-    QDomNodeList nodes = docElem.childNodes().item(0).childNodes();
-    for (unsigned int i = 0; i < nodes.length(); i++)
-    {
-        QDomElement e = nodes.item(i).toElement();
-        if(!e.isNull())
-        {
-            Node *node = nodeFactory();
-            m_graphWidget->scene()->addItem(node);
-            m_nodeList.append(node);
-            node->setHtml(e.attribute("htmlContent"));
-            node->setPos(e.attribute("x").toFloat(),
-                         e.attribute("y").toFloat());
-            node->setScale(e.attribute("scale").toFloat(),
-                           m_graphWidget->sceneRect());
-            node->setColor(QColor(e.attribute("bg_red").toFloat(),
-                                  e.attribute("bg_green").toFloat(),
-                                  e.attribute("bg_blue").toFloat()));
-            node->setTextColor(QColor(e.attribute("text_red").toFloat(),
-                                      e.attribute("text_green").toFloat(),
-                                      e.attribute("text_blue").toFloat()));
-        }
-    }
+void GraphLogic::edgeRemovedFromScene(Edge *edge)
+{
+    m_sceneEdgeCount--;
+    updateItemIndex();
 
-    // add edges
-    QDomNodeList edges = docElem.childNodes().item(1).childNodes();
-    for (unsigned int i = 0; i < edges.length(); i++)
-    {
-        QDomElement e = edges.item(i).toElement();
-        if(!e.isNull())
-        {
-            Node *source = m_nodeList[e.attribute("source").toInt()];
-            Node *destination = m_nodeList[e.attribute("destination").toInt()];
+    if (m_edgeLayer)
+        m_edgeLayer->removeEdge(edge);
+}
+
+SubtreeIndex *GraphLogic::subtreeIndex()
+{
+    return &m_subtreeIndex;
+}
 
-            Edge *edge = new Edge(source, destination);
-            source->addEdge(edge, true);
-            destination->addEdge(edge, false);
+// the bounds are not shrunk by the removals and the moves inwards, they
+// would need the bounds of all the Nodes again
+void GraphLogic::nodeGeometryChanged(Node *node)
+{
+    if (m_nodeShadow && m_nodeShadow->node() == node)
+        m_nodeShadow->updateGeometry();
 
-            edge->setColor(QColor(e.attribute("red").toFloat(),
-                                  e.attribute("green").toFloat(),
-                                  e.attribute("blue").toFloat()));
-            edge->setWidth(e.attribute("width").toFloat());
-            edge->setSecondary(e.attribute("secondary").toInt() );
+    if (!node->scene())
+        return;
 
-            m_graphWidget->scene()->addItem(edge);
-        }
-    }
+    const QRectF rect = node->sceneBoundingRect();
+    if (m_contentRect.contains(rect))
+        return;
 
-    // test the first node the active one
-    m_activeNode = m_nodeList.first();
-    m_activeNode->setBorder();
-    m_activeNode->setFocus();
+    m_contentRect |= rect;
+    m_graphWidget->growCanvas(m_contentRect);
+}
 
-    m_graphWidget->show();
-    return true;
+QRectF GraphLogic::contentRect() const
+{
+    return m_contentRect;
+}
+
+void GraphLogic::nodeBorderChanged(Node *node, const bool &hasBorder)
+{
+    if (hasBorder)
+    {
+        if (!m_nodeShadow)
+            m_nodeShadow = new NodeShadow;
+
+        m_nodeShadow->setNode(node);
+    }
+    else if (m_nodeShadow && m_nodeShadow->node() == node)
+    {
+        m_nodeShadow->setNode(0);
+    }
+}
+
+NodeShadow *GraphLogic::nodeShadow() const
+{
+    return m_nodeShadow;
 }
 
-void GraphLogic::writeContentToXmlFile(const QString &fileName)
+void GraphLogic::setEdgeLayer(const bool &enabled)
 {
-    // create XML doc object
-    QDomDocument doc("QtMindMap");
+    if (enabled == !m_edgeLayer.isNull())
+        return;
 
-    QDomElement root = doc.createElement("qtmindmap");
-    doc.appendChild( root );
+    // the layer takes the geometry of the Edges as it is
+    flushAdjusts();
 
-    // nodes
-    QDomElement nodes_root = doc.createElement("nodes");
-    root.appendChild(nodes_root);
-    foreach(Node *node, m_nodeList)
+    if (enabled)
+    {
+        m_edgeLayer = new EdgeLayer;
+        m_graphWidget->scene()->addItem(m_edgeLayer);
+    }
+    else
     {
-        QDomElement cn = doc.createElement("node");
-
-        // no need to store ID: parsing order is preorder.
-        // cn.setAttribute( "id", QString::number(m_nodeList.indexOf(node)));
-        cn.setAttribute( "x", QString::number(node->pos().x()));
-        cn.setAttribute( "y", QString::number(node->pos().y()));
-        cn.setAttribute( "htmlContent", node->toHtml());
-        cn.setAttribute( "scale", QString::number(node->scale()));
-        cn.setAttribute( "bg_red", QString::number(node->color().red()));
-        cn.setAttribute( "bg_green", QString::number(node->color().green()));
-        cn.setAttribute( "bg_blue", QString::number(node->color().blue()));
-        cn.setAttribute( "text_red", QString::number(node->textColor().red()));
-        cn.setAttribute( "text_green",
-                        QString::number(node->textColor().green()));
-        cn.setAttribute( "text_blue",
-                        QString::number(node->textColor().blue()));
-        nodes_root.appendChild(cn);
-    }
-
-    //edges
-    QDomElement edges_root = doc.createElement("edges");
-    root.appendChild(edges_root);
+        delete m_edgeLayer;
+    }
+
     foreach(Edge *edge, allEdges())
     {
-        QDomElement cn = doc.createElement("edge");
-        cn.setAttribute( "source",
-                      QString::number(m_nodeList.indexOf(edge->sourceNode())));
-        cn.setAttribute( "destination",
-                      QString::number(m_nodeList.indexOf(edge->destNode())));
-        cn.setAttribute( "red", QString::number(edge->color().red()));
-        cn.setAttribute( "green", QString::number(edge->color().green()));
-        cn.setAttribute( "blue", QString::number(edge->color().blue()));
-        cn.setAttribute( "width", QString::number(edge->width()));
-        cn.setAttribute( "secondary", QString::number(edge->secondary()));
+        if (!edge->scene())
+            continue;
 
-        edges_root.appendChild(cn);
+        edge->setFlag(QGraphicsItem::ItemHasNoContents, enabled);
+        if (enabled)
+            m_edgeLayer->insertEdge(edge);
     }
+}
 
-    // write XML doc object to file
-    QFile file(fileName);
-    if (!file.open(QIODevice::WriteOnly))
-    {
-        emit notification(tr("Couldn't open file to write."));
+EdgeLayer *GraphLogic::edgeLayer() const
+{
+    return m_edgeLayer;
+}
+
+void GraphLogic::scheduleAdjust(Edge *edge)
+{
+    m_adjustRequests++;
+    if (edge->adjustPending())
         return;
-    }
-    QTextStream ts( &file );
-    ts << doc.toString();
-    file.close();
 
-    // show a statusBar message to the user
-    emit notification(tr("Saved."));
+    edge->setAdjustPending(true);
+    m_adjustEdges.append(edge);
+    if (!m_adjustTimer.isActive())
+        m_adjustTimer.start(0);
 }
 
-void GraphLogic::writeContentToPngFile(const QString &fileName)
+void GraphLogic::cancelAdjust(Edge *edge)
 {
-    QImage img(m_graphWidget->scene()->sceneRect().width(),
-               m_graphWidget->scene()->sceneRect().height(),
-               QImage::Format_ARGB32_Premultiplied);
-    QPainter painter(&img);
+    edge->setAdjustPending(false);
+    m_adjustEdges.removeOne(edge);
+}
 
-    painter.setRenderHint(QPainter::Antialiasing);
+quint64 GraphLogic::adjustRequests() const
+{
+    return m_adjustRequests;
+}
 
-    // Strange that I have to set this, and scene->render() does not do this
-    m_graphWidget->scene()->setBackgroundBrush(GraphWidget::m_paperColor);
+quint64 GraphLogic::adjustRuns() const
+{
+    return m_adjustRuns;
+}
 
-    m_graphWidget->scene()->render(&painter);
-    painter.setBackground(GraphWidget::m_paperColor);
-    painter.end();
+// the zero timer calls it outside of painting, the moved edges update
+// their area and are drawn at the next paint; everything which reads the
+// geometry of the edges calls it first
+void GraphLogic::flushAdjusts()
+{
+    m_adjustTimer.stop();
 
-    img.save(fileName);
+    QList<Edge *> edges = m_adjustEdges;
+    m_adjustEdges.clear();
+    foreach(Edge *edge, edges)
+    {
+        edge->setAdjustPending(false);
+        edge->adjust();
+    }
 
-    // show a statusBar message to the user
-    emit notification(tr("MindMap exported as ") + fileName);
+    m_adjustRuns += edges.size();
 }
 
-Node * GraphLogic::nodeFactory()
+void GraphLogic::updateItemIndex()
 {
-    Node *node = new Node(this);
+    // the items of a closed widget leave the scene after it
+    QGraphicsScene *scene = m_graphWidget->scene();
+    if (!scene)
+        return;
 
-    connect(node, SIGNAL(nodeChanged()), this, SLOT(nodeChanged()));
-    connect(node, SIGNAL(nodeSelected()), this, SLOT(nodeSelected()));
-    connect(node, SIGNAL(nodeEdited()), this, SLOT(nodeEdited()));
-    connect(node, SIGNAL(nodeMoved(QGraphicsSceneMouseEvent*)),
-            this, SLOT(nodeMoved(QGraphicsSceneMouseEvent*)));
-    connect(node, SIGNAL(nodeLostFocus()), this, SLOT(nodeLostFocus()));
+    const int items = m_sceneNodeCount + m_sceneEdgeCount;
 
-    return node;
+    QGraphicsScene::ItemIndexMethod method = scene->itemIndexMethod();
+    if (bulkChange())
+    {
+        method = QGraphicsScene::NoIndex;
+    }
+    else if (items >= m_bspIndexItems)
+    {
+        method = QGraphicsScene::BspTreeIndex;
+    }
+    // some slack, a node added and removed at the limit does not rebuild
+    // the tree each time
+    else if (items < m_bspIndexItems / 2)
+    {
+        method = QGraphicsScene::NoIndex;
+    }
+
+    if (method != scene->itemIndexMethod())
+        scene->setItemIndexMethod(method);
+}
+
+void GraphLogic::updateEdgeLayer()
+{
+    if (!m_edgeLayer && !bulkChange() &&
+        m_sceneEdgeCount >= m_edgeLayerEdges)
+        setEdgeLayer();
 }
 
 void GraphLogic::setActiveNode(Node *node)
@@ -331,6 +1797,11 @@ void GraphLogic::reShowNumbers()
         showNodeNumbers();
 }
 
+void GraphLogic::setJournalMode(const bool &journalMode)
+{
+    m_journalMode = journalMode;
+}
+
 void GraphLogic::insertNode()
 {
     // checks
@@ -341,6 +1812,7 @@ void GraphLogic::insertNode()
     }
 
     // get the biggest angle between the edges of the Node.
+    flushAdjusts();
     double angle(m_activeNode->calculateBiggestAngle());
 
     // let the distance between the current and new Node be 100 pixels
@@ -350,16 +1822,6 @@ void GraphLogic::insertNode()
                  QPointF(length * cos(angle), length * sin(angle)) -
                  Node::newNodeCenter);
 
-    QRectF rect (m_graphWidget->scene()->sceneRect().topLeft(),
-                 m_graphWidget->scene()->sceneRect().bottomRight()
-                 - Node::newNodeBottomRigth);
-
-    if (!rect.contains(pos))
-    {
-        emit notification(tr("New node would be placed outside of the scene."));
-        return;
-    }
-
     UndoContext context;
     context.m_graphLogic = this;
     context.m_nodeList = &m_nodeList;
@@ -404,6 +1866,9 @@ void GraphLogic::nodeEdited()
     }
 
     m_editingNode = true;
+    if (!m_editedNodes.contains(m_activeNode))
+        m_editedNodes.append(m_activeNode);
+
     m_activeNode->setEditable();
     m_graphWidget->scene()->setFocusItem(m_activeNode);
 }
@@ -557,6 +2022,9 @@ void GraphLogic::insertPicture(const QString &picture)
         return;
     }
 
+    if (!m_editedNodes.contains(m_activeNode))
+        m_editedNodes.append(m_activeNode);
+
     m_activeNode->insertPicture(picture);
 }
 
@@ -676,6 +2144,78 @@ void GraphLogic::moveNode(qreal x, qreal y)
     m_undoStack->push(moveCommand);
 }
 
+void GraphLogic::beginDrag(Node *node, const bool &subtree)
+{
+    // a click in edge adding mode does not activate the Node
+    if (!node || node != m_activeNode)
+        return;
+
+    m_dragging = true;
+    m_dragSubtree = subtree;
+    m_dragOffset = QPointF();
+    m_dragNodes.clear();
+
+    if (subtree)
+    {
+        m_dragNodes = m_activeNode->subtree();
+    }
+    else
+    {
+        m_dragNodes.push_back(m_activeNode);
+    }
+
+    updateItemIndex();
+}
+
+void GraphLogic::drag(const qreal &x, const qreal &y)
+{
+    if (!m_dragging)
+        return;
+
+    foreach(Node *node, m_dragNodes)
+        node->moveBy(x, y);
+
+    m_dragOffset += QPointF(x, y);
+}
+
+void GraphLogic::endDrag()
+{
+    if (!m_dragging)
+        return;
+
+    m_dragging = false;
+    updateItemIndex();
+    if (m_dragOffset.isNull() || !m_undoStack)
+    {
+        m_dragNodes.clear();
+        return;
+    }
+
+    UndoContext context;
+    context.m_graphLogic = this;
+    context.m_nodeList = &m_nodeList;
+    context.m_activeNode = m_activeNode;
+    context.m_x = m_dragOffset.x();
+    context.m_y = m_dragOffset.y();
+    context.m_subtree = m_dragSubtree;
+
+    QUndoCommand *moveCommand = new MoveCommand(context, m_dragNodes);
+    m_dragNodes.clear();
+    m_undoStack->push(moveCommand);
+}
+
+bool GraphLogic::isDragging() const
+{
+    return m_dragging;
+}
+
+// moving or adding many items is cheaper without an index to update
+bool GraphLogic::bulkChange() const
+{
+    return m_loading || m_readingFile ||
+           (m_dragging && m_dragNodes.size() >= m_bulkDragNodes);
+}
+
 void GraphLogic::appendNumber(const int &num)
 {
     m_hintNumber.append(QString::number(num));
@@ -726,12 +2266,15 @@ QList<Edge *> GraphLogic::allEdges() const
     QList<Edge *> list;
 
     // GraphWidget has a list of Nodes only.
-    // Each Node maintains a list of it's own Edges.
-    // We iterate through the list of Nodes and call Node::edgesFrom() on them.
-    // edgesFrom(exludeSecundaries=false) return a list of edges (including
-    // secondary edges) which starts from this Node.
+    // Each Node maintains a list of it's own Edges,
+    // every Edge is taken at its source Node.
     foreach(Node * node, m_nodeList)
-        list.append(node->edgesFrom(false));
+    {
+        list.append(node->childEdges());
+        foreach(Edge *edge, node->secondaryEdges())
+            if (edge->sourceNode() == node)
+                list.append(edge);
+    }
 
     return list;
 }
@@ -753,7 +2296,8 @@ void GraphLogic::addEdge(Node *source, Node *destination)
 
     // aviod the graph beeing acyclic. (ok, Nodes having multiple parents)
     bool sec(false);
-    if (!destination->edgesToThis().empty())
+    if (!destination->parentEdges().isEmpty() ||
+        source->isInSubtreeOf(destination))
     {
         emit notification(
            QObject::tr("The graph is acyclic, edge added as secondary edge."));
@@ -9,14 +9,17 @@
 #include <math.h>
 
 const QColor GraphWidget::m_paperColor(255,255,153);
+const QRectF GraphWidget::m_defaultCanvas(-400, -400, 800, 800);
+const qreal GraphWidget::m_canvasMargin = 400;
 
 GraphWidget::GraphWidget(MainWindow *parent)
     : QGraphicsView(parent)
     , m_parent(parent)
 {
     m_scene = new QGraphicsScene(this);
+    // GraphLogic::updateItemIndex() turns on a BSP tree for big maps
     m_scene->setItemIndexMethod(QGraphicsScene::NoIndex);
-    m_scene->setSceneRect(-400, -400, 800, 800);
+    m_scene->setSceneRect(m_defaultCanvas);
     setScene(m_scene);
 
     setCacheMode(CacheBackground);
@@ -48,6 +51,35 @@ GraphLogic *GraphWidget::graphLogic() const
     return m_graphlogic;
 }
 
+void GraphWidget::growCanvas(const QRectF &content)
+{
+    const QRectF canvas = m_scene->sceneRect();
+    if (canvas.contains(content))
+        return;
+
+    // at least a quarter of the canvas is added, a Node dragged over the
+    // border does not resize the scene at each step
+    const qreal margin = qMax(m_canvasMargin,
+                              qMax(canvas.width(), canvas.height()) / 4);
+
+    QRectF grown(canvas);
+    if (content.left() < canvas.left())
+        grown.setLeft(content.left() - margin);
+    if (content.top() < canvas.top())
+        grown.setTop(content.top() - margin);
+    if (content.right() > canvas.right())
+        grown.setRight(content.right() + margin);
+    if (content.bottom() > canvas.bottom())
+        grown.setBottom(content.bottom() + margin);
+
+    m_scene->setSceneRect(grown);
+}
+
+void GraphWidget::resetCanvas()
+{
+    m_scene->setSceneRect(m_defaultCanvas);
+}
+
 void GraphWidget::zoomIn()
 {
     scaleView(qreal(0.2));
@@ -94,11 +126,16 @@ void GraphWidget::wheelEvent(QWheelEvent *event)
 
 void GraphWidget::drawBackground(QPainter *painter, const QRectF &rect)
 {
-    Q_UNUSED(rect);
+    // only the exposed part, whatever the size of the canvas is
+    const QRectF canvas = m_scene->sceneRect();
+    painter->fillRect(rect & canvas, GraphWidget::m_paperColor);
 
-    painter->fillRect(m_scene->sceneRect(), GraphWidget::m_paperColor);
-    painter->setBrush(Qt::NoBrush);
-    painter->drawRect(m_scene->sceneRect());
+    // the border only when it is in sight
+    if (!canvas.adjusted(1, 1, -1, -1).contains(rect))
+    {
+        painter->setBrush(Qt::NoBrush);
+        painter->drawRect(canvas);
+    }
 }
 
 void GraphWidget::scaleView(qreal factor)
@@ -0,0 +1,131 @@
+#include "include/journal.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QDateTime>
+
+static const quint32 journalMagic = 0x514d4d4a; // "QMMJ"
+static const quint32 journalVersion = 1;
+static const int journalHeaderSize = 20;
+
+// below this the journal is never compacted
+const qint64 Journal::m_minimumCompactionSize = 64 * 1024;
+
+Journal::Journal(const QString &mapFileName)
+    : m_mapFileName(mapFileName)
+{
+}
+
+QString Journal::fileName() const
+{
+    return m_mapFileName + ".journal";
+}
+
+bool Journal::exists() const
+{
+    return QFile::exists(fileName());
+}
+
+bool Journal::belongsToMap() const
+{
+    QFile file(fileName());
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    return file.read(journalHeaderSize) == mapStamp();
+}
+
+bool Journal::needsCompaction() const
+{
+    // replaying the journal shall not cost more than reading the map again
+    return QFileInfo(fileName()).size() >
+            qMax(m_minimumCompactionSize, QFileInfo(m_mapFileName).size() / 2);
+}
+
+QList<QByteArray> Journal::readBatches() const
+{
+    QList<QByteArray> batches;
+
+    QFile file(fileName());
+    if (!file.open(QIODevice::ReadOnly))
+        return batches;
+
+    file.seek(journalHeaderSize);
+    QDataStream stream(&file);
+    while (!stream.atEnd())
+    {
+        quint32 length;
+        stream >> length;
+        QByteArray batch = file.read(length);
+        if (stream.status() != QDataStream::Ok ||
+            quint32(batch.size()) != length)
+            break;
+
+        batches.append(batch);
+    }
+
+    return batches;
+}
+
+bool Journal::append(const QByteArray &batch) const
+{
+    QFile file(fileName());
+    if (!file.open(QIODevice::ReadWrite))
+        return false;
+
+    // new journal, or drop the partially written batch of a crashed save
+    qint64 end(journalHeaderSize);
+    if (file.size() < journalHeaderSize)
+    {
+        if (!file.resize(0) || file.write(mapStamp()) != journalHeaderSize)
+            return false;
+    }
+    else
+    {
+        QDataStream stream(&file);
+        file.seek(journalHeaderSize);
+        while (end + 4 <= file.size())
+        {
+            quint32 length;
+            stream >> length;
+            if (end + 4 + length > file.size())
+                break;
+
+            end += 4 + length;
+            file.seek(end);
+        }
+
+        if (end != file.size() && !file.resize(end))
+            return false;
+    }
+
+    file.seek(end);
+    QDataStream stream(&file);
+    stream << quint32(batch.size());
+    if (file.write(batch) != batch.size())
+        return false;
+
+    file.close();
+    return file.error() == QFile::NoError;
+}
+
+void Journal::remove() const
+{
+    QFile::remove(fileName());
+}
+
+// the header of the journal: the size and modification time of the map
+QByteArray Journal::mapStamp() const
+{
+    QFileInfo mapFileInfo(m_mapFileName);
+
+    QByteArray header;
+    QDataStream stream(&header, QIODevice::WriteOnly);
+    stream << journalMagic
+           << journalVersion
+           << qint64(mapFileInfo.size())
+           << quint32(mapFileInfo.lastModified().toTime_t());
+
+    return header;
+}
@@ -0,0 +1,123 @@
+#include "include/layoutmath.h"
+
+#include <QtAlgorithms>
+
+#include <math.h>
+
+// there is no such thing as modulo operator for double :P
+double LayoutMath::modulo(const double &devided, const double &devisor)
+{
+    return devided - static_cast<double>(devisor * static_cast<int>(devided
+                                                                  / devisor));
+}
+
+double LayoutMath::biggestGapAngle(QList<double> angles)
+{
+    qSort(angles.begin(), angles.end());
+
+    // find the biggest diffrence, store prev angle
+    double prev(angles.first());
+    double max_prev(angles.last());
+    double max(twoPi - angles.last() + angles.first());
+
+    for(QList<double>::const_iterator it = ++angles.constBegin();
+        it != angles.constEnd(); it++)
+    {
+        if (*it - prev > max )
+        {
+            max = *it - prev;
+            max_prev = prev;
+        }
+        prev = *it;
+    }
+
+    // return with prev angle + max diff / 2
+    return twoPi - modulo(max_prev + max / 2, twoPi);
+}
+
+bool LayoutMath::roundedRectContains(const QRectF &rect,
+                                     qreal xRadius, qreal yRadius,
+                                     const QPointF &point)
+{
+    if (!rect.contains(point))
+        return false;
+
+    xRadius = qMin(xRadius, rect.width() / 2);
+    yRadius = qMin(yRadius, rect.height() / 2);
+    if (xRadius <= 0 || yRadius <= 0)
+        return true;
+
+    // the distance from the nearest corner circle's center, if any
+    const qreal dx = qMax(qreal(0), qMax(rect.left() + xRadius - point.x(),
+                                         point.x() - rect.right() + xRadius));
+    const qreal dy = qMax(qreal(0), qMax(rect.top() + yRadius - point.y(),
+                                         point.y() - rect.bottom() + yRadius));
+
+    return (dx * dx) / (xRadius * xRadius) +
+            (dy * dy) / (yRadius * yRadius) <= 1;
+}
+
+QPointF LayoutMath::roundedRectExit(const QRectF &rect,
+                                    qreal xRadius, qreal yRadius,
+                                    const QPointF &origin,
+                                    const QPointF &direction)
+{
+    if (direction.isNull() ||
+        !roundedRectContains(rect, xRadius, yRadius, origin))
+        return origin;
+
+    xRadius = qMin(xRadius, rect.width() / 2);
+    yRadius = qMin(yRadius, rect.height() / 2);
+
+    // leaving the bounding rect first, the sides are part of the shape
+    qreal t = -1;
+    if (direction.x() > 0)
+        t = (rect.right() - origin.x()) / direction.x();
+    else if (direction.x() < 0)
+        t = (rect.left() - origin.x()) / direction.x();
+
+    if (direction.y() > 0)
+    {
+        const qreal ty = (rect.bottom() - origin.y()) / direction.y();
+        t = t < 0 ? ty : qMin(t, ty);
+    }
+    else if (direction.y() < 0)
+    {
+        const qreal ty = (rect.top() - origin.y()) / direction.y();
+        t = t < 0 ? ty : qMin(t, ty);
+    }
+
+    const QPointF boxExit = origin + direction * t;
+    if (xRadius <= 0 || yRadius <= 0)
+        return boxExit;
+
+    // on the straight part of a side
+    const bool inCornerColumn = boxExit.x() < rect.left() + xRadius ||
+            boxExit.x() > rect.right() - xRadius;
+    const bool inCornerRow = boxExit.y() < rect.top() + yRadius ||
+            boxExit.y() > rect.bottom() - yRadius;
+    if (!inCornerColumn || !inCornerRow)
+        return boxExit;
+
+    /* between the shape and the box the ray stays in the same corner,
+       it leaves through the elliptic arc there: the bigger root of
+       ((o + t d - c) / r)^2 = 1 for both coordinates */
+    const QPointF center(boxExit.x() < rect.center().x() ?
+                             rect.left() + xRadius :
+                             rect.right() - xRadius,
+                         boxExit.y() < rect.center().y() ?
+                             rect.top() + yRadius :
+                             rect.bottom() - yRadius);
+
+    const qreal ox = (origin.x() - center.x()) / xRadius;
+    const qreal oy = (origin.y() - center.y()) / yRadius;
+    const qreal dx = direction.x() / xRadius;
+    const qreal dy = direction.y() / yRadius;
+
+    const qreal a = dx * dx + dy * dy;
+    const qreal b = 2 * (ox * dx + oy * dy);
+    const qreal c = ox * ox + oy * oy - 1;
+    const qreal discriminant = qMax(qreal(0), b * b - 4 * a * c);
+
+    return origin + direction * ((-b + sqrt(discriminant)) / (2 * a));
+}
@@ -8,6 +8,7 @@
 #include "include/mainwindow.h"
 #include "include/systemtray.h"
 #include "include/argumentparser.h"
+#include "include/batchrunner.h"
 
 int main(int argc, char *argv[])
 {
@@ -35,6 +36,13 @@ int main(int argc, char *argv[])
     if (!argParser.parseCmdLineArgs())
         return EXIT_FAILURE;
 
+    // export or convert, then exit without showing a window
+    if (argParser.isHeadless())
+    {
+        BatchRunner batchRunner;
+        return batchRunner.run(argParser);
+    }
+
     // system tray?
     MainWindow w;
     SystemTray *systemtray;
@@ -3,6 +3,7 @@
 
 #include <QDebug>
 #include <QFileDialog>
+#include <QInputDialog>
 #include <QMessageBox>
 
 MainWindow::MainWindow(QWidget *parent) :
@@ -16,6 +17,8 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(m_ui->actionOpen, SIGNAL(activated()), this, SLOT(openFile()));
     connect(m_ui->actionSave, SIGNAL(activated()), this, SLOT(saveFile()));
     connect(m_ui->actionSaveAs, SIGNAL(activated()), this, SLOT(saveFileAs()));
+    connect(m_ui->actionSaveAsBinary, SIGNAL(activated()),
+            this, SLOT(saveFileAsBinary()));
     connect(m_ui->actionClose, SIGNAL(activated()), this, SLOT(closeFile()));
     connect(m_ui->actionExport, SIGNAL(activated()), this, SLOT(exportScene()));
     connect(m_ui->actionQuit, SIGNAL(activated()), this, SLOT(quit()));
@@ -36,6 +39,25 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(m_graphicsView->graphLogic(), SIGNAL(notification(QString)),
             this, SLOT(statusBarMsg(QString)));
 
+    connect(m_ui->actionJournal, SIGNAL(toggled(bool)),
+            m_graphicsView->graphLogic(), SLOT(setJournalMode(bool)));
+
+    // progress of opening a file, hidden by def
+    m_loadProgress = new QProgressBar(this);
+    m_loadProgress->setMaximumWidth(200);
+    m_loadProgress->hide();
+    m_ui->statusBar->addPermanentWidget(m_loadProgress);
+    m_loadCancel = new QPushButton(tr("Cancel"), this);
+    m_loadCancel->hide();
+    m_ui->statusBar->addPermanentWidget(m_loadCancel);
+
+    connect(m_loadCancel, SIGNAL(clicked()),
+            m_graphicsView->graphLogic(), SLOT(cancelLoading()));
+    connect(m_graphicsView->graphLogic(),
+            SIGNAL(loadProgress(const int&, const int&)),
+            this, SLOT(loadProgress(const int&, const int&)));
+    connect(m_graphicsView->graphLogic(), SIGNAL(loadFinished(const bool&)),
+            this, SLOT(openFinished(const bool&)));
 
     // setup toolbars, don't show them
     setupMainToolbar();
@@ -66,8 +88,10 @@ void MainWindow::contentChanged(const bool& changed)
         setWindowTitle(windowTitle().prepend("* "));
         m_contentChanged = true;
 
+        // a partially opened map can't be saved
         QFileInfo fileInfo(m_fileName);
-        if (m_fileName != tr("untitled") && fileInfo.isWritable())
+        if (m_fileName != tr("untitled") && fileInfo.isWritable() &&
+            !m_graphicsView->graphLogic()->isLoading())
             m_ui->actionSave->setEnabled(true);
     }
     else if (m_contentChanged == true && changed == false)
@@ -87,6 +111,7 @@ void MainWindow::newFile()
 
     m_ui->actionSave->setEnabled(false);
     m_ui->actionSaveAs->setEnabled(true);
+    m_ui->actionSaveAsBinary->setEnabled(true);
     m_ui->actionClose->setEnabled(true);
     m_ui->actionExport->setEnabled(true);
     contentChanged(false);
@@ -109,7 +134,7 @@ void MainWindow::openFile(const QString &fileName)
         QFileDialog dialog(this,
                            tr("Open MindMap"),
                            QDir::homePath(),
-                           QString("QtMindMap (*.qmm)"));
+                           QString("QtMindMap (*.qmm *.qmmb)"));
         dialog.setAcceptMode(QFileDialog::AcceptOpen);
         dialog.setDefaultSuffix("qmm");
 
@@ -127,26 +152,53 @@ void MainWindow::openFile(const QString &fileName)
     if (!fileInfo.isWritable())
         statusBarMsg(tr("Read-only file!"));
 
-    if (!m_graphicsView->graphLogic()->readContentFromXmlFile(m_fileName))
+    // the nodes arrive while the event loop runs, openFinished() is
+    // called at the end
+    m_previousFileName = currFilename;
+    m_loadProgress->setValue(0);
+    m_loadProgress->show();
+    m_loadCancel->show();
+
+    contentChanged(false);
+
+    fileInfo.isWritable() ?
+         setTitle(m_fileName) :
+         setTitle(tr("readonly ").append(m_fileName));
+
+    showMainToolbar();
+
+    m_graphicsView->graphLogic()->readContentInBackground(m_fileName);
+}
+
+void MainWindow::loadProgress(const int &done, const int &total)
+{
+    m_loadProgress->setMaximum(total);
+    m_loadProgress->setValue(done);
+}
+
+void MainWindow::openFinished(const bool &success)
+{
+    m_loadProgress->hide();
+    m_loadCancel->hide();
+
+    if (!success)
     {
-        m_fileName = currFilename;
+        m_fileName = m_previousFileName;
+        setTitle("");
+        m_graphicsView->hide();
+        showMainToolbar(false);
         return;
     }
 
-
     m_ui->actionSaveAs->setEnabled(true);
+    m_ui->actionSaveAsBinary->setEnabled(true);
     m_ui->actionClose->setEnabled(true);
     m_ui->actionExport->setEnabled(true);
     m_ui->actionSave->setEnabled(false);
-    m_ui->actionSave->setEnabled(false);
 
+    // commands done on the already loaded nodes are changes
     contentChanged(false);
-
-    fileInfo.isWritable() ?
-         setTitle(m_fileName) :
-         setTitle(tr("readonly ").append(m_fileName));
-
-    showMainToolbar();
+    contentChanged(m_undoStack->count() != 0);
 }
 
 void MainWindow::saveFile(const bool &checkIfReadonly)
@@ -158,7 +210,7 @@ void MainWindow::saveFile(const bool &checkIfReadonly)
         return;
     }
 
-    m_graphicsView->graphLogic()->writeContentToXmlFile(m_fileName);
+    m_graphicsView->graphLogic()->writeChangesToFile(m_fileName);
     contentChanged(false);
 
     m_undoStack->clear();
@@ -182,9 +234,44 @@ bool MainWindow::saveFileAs()
     return true;
 }
 
+bool MainWindow::saveFileAsBinary()
+{
+    QFileDialog dialog(this,
+                       tr("Save MindMap as binary"),
+                       QDir::homePath(),
+                       QString("QtMindMap binary (*.qmmb)"));
+    dialog.setAcceptMode(QFileDialog::AcceptSave);
+    dialog.setDefaultSuffix("qmmb");
+
+    if (!dialog.exec())
+        return false;
+
+    // the file format is chosen by the .qmmb suffix
+    m_fileName = dialog.selectedFiles().first();
+    saveFile(false);
+    setTitle(m_fileName);
+    return true;
+}
+
 bool MainWindow::closeFile()
 {
-    if (m_contentChanged)
+    // a partially opened map can't be saved, only dropped
+    if (m_graphicsView->graphLogic()->isLoading())
+    {
+        QMessageBox msgBox(this);
+        msgBox.setWindowTitle(tr("Close mindmap - qtmindmap"));
+        msgBox.setText(tr("The mindmap is still being opened."));
+        msgBox.setInformativeText(
+                    tr("Do you want to discard the partially opened map?"));
+        msgBox.setStandardButtons(QMessageBox::Discard |
+                                  QMessageBox::Cancel);
+        msgBox.setDefaultButton(QMessageBox::Cancel);
+        if (msgBox.exec() != QMessageBox::Discard)
+            return false;
+
+        m_graphicsView->graphLogic()->cancelLoading();
+    }
+    else if (m_contentChanged)
     {
         QMessageBox msgBox(this);
         msgBox.setWindowTitle(tr("Save mindmap - qtmindmap"));
@@ -222,6 +309,7 @@ bool MainWindow::closeFile()
 
     m_ui->actionSave->setEnabled(false);
     m_ui->actionSaveAs->setEnabled(false);
+    m_ui->actionSaveAsBinary->setEnabled(false);
     m_ui->actionClose->setEnabled(false);
     m_ui->actionExport->setEnabled(false);
     m_contentChanged = false;
@@ -238,15 +326,30 @@ void MainWindow::exportScene()
     QFileDialog dialog(this,
                        tr("Export MindMap to image"),
                        QDir::homePath(),
-                       tr("PNG image file (*.png)"));
+                       tr("PNG image file (*.png);;SVG image file (*.svg)"));
     dialog.setAcceptMode(QFileDialog::AcceptSave);
     dialog.setDefaultSuffix("png");
 
-     if (dialog.exec())
+     if (!dialog.exec())
+         return;
+
+     QString fileName = dialog.selectedFiles().first();
+     if (fileName.endsWith(".svg", Qt::CaseInsensitive))
      {
-         m_graphicsView->graphLogic()->writeContentToPngFile(
-                                            dialog.selectedFiles().first());
+         m_graphicsView->graphLogic()->writeContentToSvgFile(fileName);
+         return;
      }
+
+     // 96 DPI is the size of the map on the screen
+     bool ok;
+     int dpi = QInputDialog::getInt(this,
+                                    tr("Export MindMap to image"),
+                                    tr("Resolution (DPI):"),
+                                    96, 24, 2400, 1, &ok);
+     if (!ok)
+         return;
+
+     m_graphicsView->graphLogic()->writeContentToPngFile(fileName, dpi);
 }
 
 void MainWindow::about()
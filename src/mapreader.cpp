@@ -0,0 +1,422 @@
+#include "include/mapreader.h"
+
+#include <QObject>
+#include <QSet>
+#include <QtEndian>
+
+#include "include/binarylayout.h"
+
+#include <string.h>
+
+MapReader *MapReader::open(const QString &fileName)
+{
+    QFile *file = new QFile(fileName);
+    if (!file->open(QIODevice::ReadOnly))
+    {
+        delete file;
+        return 0;
+    }
+
+    MapReader *reader;
+    if (file->peek(4) == QByteArray(BinaryLayout::magic, 4))
+    {
+        reader = new BinaryMapReader(file);
+    }
+    else
+    {
+        reader = new XmlMapReader(file);
+    }
+
+    reader->m_ownedDevice.reset(file);
+    return reader;
+}
+
+QString MapReader::read(const QString &fileName, MapData *map)
+{
+    QScopedPointer<MapReader> reader(open(fileName));
+    if (!reader)
+        return QObject::tr("Couldn't read file.");
+
+    QSet<int> ids;
+    TokenType token;
+    while ((token = reader->readNext()) != EndOfMap && !reader->hasError())
+    {
+        if (token == NodeRecord)
+        {
+            if (ids.contains(reader->node().m_id))
+            {
+                reader->raiseError(QObject::tr("Duplicated node id: %1")
+                                   .arg(reader->node().m_id));
+                break;
+            }
+
+            ids.insert(reader->node().m_id);
+            map->m_nodes.append(reader->node());
+        }
+        else
+        {
+            if (!ids.contains(reader->edge().m_source) ||
+                !ids.contains(reader->edge().m_destination))
+            {
+                reader->raiseError(
+                        QObject::tr("Edge refers to a non-existent node."));
+                break;
+            }
+
+            map->m_edges.append(reader->edge());
+        }
+    }
+
+    if (!reader->hasError() && map->m_nodes.isEmpty())
+        reader->raiseError(QObject::tr("The map has no nodes."));
+
+    if (reader->hasError())
+    {
+        *map = MapData();
+        return QObject::tr("Couldn't parse file: %1")
+                .arg(reader->errorString());
+    }
+
+    return QString();
+}
+
+const NodeData &MapReader::node() const
+{
+    return m_node;
+}
+
+const EdgeData &MapReader::edge() const
+{
+    return m_edge;
+}
+
+void MapReader::raiseError(const QString &message)
+{
+    if (m_error.isEmpty())
+        m_error = message;
+}
+
+bool MapReader::hasError() const
+{
+    return !errorString().isEmpty();
+}
+
+QString MapReader::errorString() const
+{
+    return m_error;
+}
+
+XmlMapReader::XmlMapReader(QIODevice *device)
+    : m_xml(device)
+    , m_state(Start)
+    , m_position(0)
+{
+}
+
+MapReader::TokenType XmlMapReader::readNext()
+{
+    if (m_state == Start)
+    {
+        if (m_xml.readNextStartElement() && m_xml.name() != "qtmindmap")
+            m_xml.raiseError(QObject::tr("Not a QtMindMap file."));
+
+        // the first child of the root holds the nodes, the second the edges
+        if (!m_xml.hasError() &&
+            !(m_xml.readNextStartElement() && m_xml.name() == "nodes"))
+            m_xml.raiseError(QObject::tr("Expected nodes element."));
+
+        m_state = Nodes;
+    }
+
+    if (m_state == Nodes && !m_xml.hasError())
+    {
+        if (m_xml.readNextStartElement())
+        {
+            readNodeElement();
+            return m_xml.hasError() ? Invalid : NodeRecord;
+        }
+
+        if (!m_xml.hasError() &&
+            !(m_xml.readNextStartElement() && m_xml.name() == "edges"))
+            m_xml.raiseError(QObject::tr("Expected edges element."));
+
+        m_state = Edges;
+    }
+
+    if (m_state == Edges && !m_xml.hasError())
+    {
+        if (m_xml.readNextStartElement())
+        {
+            readEdgeElement();
+            return m_xml.hasError() ? Invalid : EdgeRecord;
+        }
+
+        m_state = End;
+    }
+
+    return m_xml.hasError() ? Invalid : EndOfMap;
+}
+
+void XmlMapReader::raiseError(const QString &message)
+{
+    m_xml.raiseError(message);
+}
+
+QString XmlMapReader::errorString() const
+{
+    if (!m_xml.hasError())
+        return QString();
+
+    return QObject::tr("%1 (line %2, column %3)")
+            .arg(m_xml.errorString())
+            .arg(m_xml.lineNumber())
+            .arg(m_xml.columnNumber());
+}
+
+void XmlMapReader::readNodeElement()
+{
+    if (m_xml.name() != "node")
+    {
+        m_xml.raiseError(QObject::tr("Expected node element."));
+        return;
+    }
+
+    QXmlStreamAttributes attributes = m_xml.attributes();
+
+    // files saved without ids refer to the nodes with their position
+    m_node.m_id = m_position++;
+    if (attributes.hasAttribute("id"))
+    {
+        bool ok;
+        m_node.m_id = attributes.value("id").toString().toInt(&ok);
+        if (!ok || m_node.m_id < 0)
+        {
+            m_xml.raiseError(QObject::tr("Invalid node id."));
+            return;
+        }
+    }
+
+    // old files have the whole document in htmlContent
+    if (attributes.hasAttribute("text"))
+    {
+        m_node.m_contentType = NodeData::PlainText;
+        m_node.m_content = attributes.value("text").toString();
+    }
+    else if (attributes.hasAttribute("html"))
+    {
+        m_node.m_contentType = NodeData::HtmlFragment;
+        m_node.m_content = attributes.value("html").toString();
+    }
+    else
+    {
+        m_node.m_contentType = NodeData::HtmlDocument;
+        m_node.m_content = attributes.value("htmlContent").toString();
+    }
+
+    m_node.m_x = attributes.value("x").toString().toDouble();
+    m_node.m_y = attributes.value("y").toString().toDouble();
+    m_node.m_scale = attributes.value("scale").toString().toDouble();
+    m_node.m_color = mapColor(
+                attributes.value("bg_red").toString().toDouble(),
+                attributes.value("bg_green").toString().toDouble(),
+                attributes.value("bg_blue").toString().toDouble());
+    m_node.m_textColor = mapColor(
+                attributes.value("text_red").toString().toDouble(),
+                attributes.value("text_green").toString().toDouble(),
+                attributes.value("text_blue").toString().toDouble());
+
+    m_xml.skipCurrentElement();
+}
+
+void XmlMapReader::readEdgeElement()
+{
+    if (m_xml.name() != "edge")
+    {
+        m_xml.raiseError(QObject::tr("Expected edge element."));
+        return;
+    }
+
+    QXmlStreamAttributes attributes = m_xml.attributes();
+
+    bool sourceOk, destinationOk;
+    m_edge.m_source = attributes.value("source").toString().toInt(&sourceOk);
+    m_edge.m_destination =
+            attributes.value("destination").toString().toInt(&destinationOk);
+    if (!sourceOk || !destinationOk)
+    {
+        m_xml.raiseError(QObject::tr("Invalid edge end node."));
+        return;
+    }
+
+    m_edge.m_color = mapColor(attributes.value("red").toString().toDouble(),
+                              attributes.value("green").toString().toDouble(),
+                              attributes.value("blue").toString().toDouble());
+    m_edge.m_width = attributes.value("width").toString().toDouble();
+    m_edge.m_secondary = attributes.value("secondary").toString().toInt();
+
+    m_xml.skipCurrentElement();
+}
+
+// little endian IEEE 754 double from the mapped file
+static qreal readDouble(const uchar *src)
+{
+    quint64 bits = qFromLittleEndian<quint64>(src);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+BinaryMapReader::BinaryMapReader(QFile *file)
+    : m_file(file)
+    , m_map(0)
+    , m_buffer()
+    , m_data(0)
+    , m_size(file->size())
+    , m_nodeCount(0)
+    , m_edgeCount(0)
+    , m_heapOffset(0)
+    , m_heapSize(0)
+    , m_nodeTableOffset(0)
+    , m_edgeTableOffset(0)
+    , m_next(0)
+{
+    // no parsing: the records are decoded straight from the mapped file
+    m_map = m_file->map(0, m_size);
+    if (m_map)
+    {
+        m_data = m_map;
+    }
+    else
+    {
+        m_buffer = m_file->readAll();
+        m_data = reinterpret_cast<const uchar *>(m_buffer.constData());
+    }
+
+    if (m_size < BinaryLayout::headerSize ||
+        memcmp(m_data, BinaryLayout::magic, 4) != 0)
+    {
+        raiseError(QObject::tr("Not a QtMindMap binary file."));
+        return;
+    }
+
+    using namespace BinaryLayout;
+    if (qFromLittleEndian<quint32>(m_data + VersionOffset) != version)
+    {
+        raiseError(QObject::tr("Unsupported QtMindMap binary file version."));
+        return;
+    }
+
+    m_nodeCount = qFromLittleEndian<quint32>(m_data + NodeCountOffset);
+    m_edgeCount = qFromLittleEndian<quint32>(m_data + EdgeCountOffset);
+    m_heapOffset = qFromLittleEndian<quint32>(m_data + HeapOffsetOffset);
+    m_heapSize = qFromLittleEndian<quint32>(m_data + HeapSizeOffset);
+    m_nodeTableOffset =
+            qFromLittleEndian<quint32>(m_data + NodeTableOffsetOffset);
+    m_edgeTableOffset =
+            qFromLittleEndian<quint32>(m_data + EdgeTableOffsetOffset);
+
+    // every section has to be inside of the file
+    if (qint64(m_heapOffset) + m_heapSize > m_size ||
+        qint64(m_nodeTableOffset) +
+            qint64(m_nodeCount) * nodeRecordSize > m_size ||
+        qint64(m_edgeTableOffset) +
+            qint64(m_edgeCount) * edgeRecordSize > m_size)
+    {
+        raiseError(QObject::tr("Truncated QtMindMap binary file."));
+        return;
+    }
+}
+
+BinaryMapReader::~BinaryMapReader()
+{
+    if (m_map)
+        m_file->unmap(m_map);
+}
+
+MapReader::TokenType BinaryMapReader::readNext()
+{
+    if (hasError())
+        return Invalid;
+
+    if (m_next < m_nodeCount)
+    {
+        readNodeRecord(m_data + m_nodeTableOffset +
+                       m_next++ * BinaryLayout::nodeRecordSize);
+        return hasError() ? Invalid : NodeRecord;
+    }
+
+    if (m_next < m_nodeCount + m_edgeCount)
+    {
+        readEdgeRecord(m_data + m_edgeTableOffset +
+                       (m_next++ - m_nodeCount) *
+                            BinaryLayout::edgeRecordSize);
+        return EdgeRecord;
+    }
+
+    return EndOfMap;
+}
+
+int BinaryMapReader::nodeCount() const
+{
+    return m_nodeCount;
+}
+
+int BinaryMapReader::edgeCount() const
+{
+    return m_edgeCount;
+}
+
+void BinaryMapReader::readNodeRecord(const uchar *record)
+{
+    using namespace BinaryLayout;
+
+    m_node.m_id = qFromLittleEndian<qint32>(record + NodeIdOffset);
+    m_node.m_color = qFromLittleEndian<quint32>(record + NodeColorOffset);
+    m_node.m_textColor =
+            qFromLittleEndian<quint32>(record + NodeTextColorOffset);
+    m_node.m_x = readDouble(record + NodeXOffset);
+    m_node.m_y = readDouble(record + NodeYOffset);
+    m_node.m_scale = readDouble(record + NodeScaleOffset);
+
+    quint32 type = qFromLittleEndian<quint32>(record + NodeContentTypeOffset);
+    if (type > NodeData::PlainText)
+    {
+        raiseError(QObject::tr("Unknown node content type: %1").arg(type));
+        return;
+    }
+
+    m_node.m_contentType = NodeData::ContentType(type);
+
+    quint32 offset = qFromLittleEndian<quint32>(record + NodeContentOffset);
+    quint32 length =
+            qFromLittleEndian<quint32>(record + NodeContentLengthOffset);
+    if (qint64(offset) + qint64(length) * 2 > m_heapSize || offset % 2)
+    {
+        raiseError(QObject::tr("Node content is out of the string heap."));
+        return;
+    }
+
+    const uchar *content = m_data + m_heapOffset + offset;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    m_node.m_content =
+            QString(reinterpret_cast<const QChar *>(content), length);
+#else
+    m_node.m_content.resize(length);
+    for (quint32 i = 0; i < length; i++)
+        m_node.m_content[i] =
+                QChar(qFromLittleEndian<quint16>(content + i * 2));
+#endif
+}
+
+void BinaryMapReader::readEdgeRecord(const uchar *record)
+{
+    using namespace BinaryLayout;
+
+    m_edge.m_source = qFromLittleEndian<qint32>(record + EdgeSourceOffset);
+    m_edge.m_destination =
+            qFromLittleEndian<qint32>(record + EdgeDestinationOffset);
+    m_edge.m_color = qFromLittleEndian<quint32>(record + EdgeColorOffset);
+    m_edge.m_secondary =
+       qFromLittleEndian<quint32>(record + EdgeFlagsOffset) & secondaryFlag;
+    m_edge.m_width = readDouble(record + EdgeWidthOffset);
+}
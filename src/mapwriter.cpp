@@ -0,0 +1,365 @@
+#include "include/mapwriter.h"
+
+#include <QFile>
+#include <QObject>
+#include <QScopedPointer>
+#include <QtEndian>
+
+#include "include/binarylayout.h"
+#include "include/mapreader.h"
+
+#include <string.h>
+#include <stdio.h>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+MapWriter::Format MapWriter::formatOfFileName(const QString &fileName)
+{
+    return fileName.endsWith(".qmmb", Qt::CaseInsensitive) ?
+                BinaryFormat :
+                XmlFormat;
+}
+
+MapWriter *MapWriter::create(QIODevice *device, const Format &format)
+{
+    if (format == BinaryFormat)
+        return new BinaryMapWriter(device);
+
+    return new XmlMapWriter(device);
+}
+
+QString MapWriter::write(const QString &fileName, const MapData &map)
+{
+    // a map has a base node at least, an empty one is a bug upstream
+    if (map.m_nodes.isEmpty())
+        return QObject::tr("The map has no nodes, it was not written.");
+
+    QString tempFileName(fileName + ".saving");
+    QFile file(tempFileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return QObject::tr("Couldn't open file to write.");
+
+    QScopedPointer<MapWriter> writer(create(&file,
+                                            formatOfFileName(fileName)));
+    writer->begin();
+
+    foreach(const NodeData &node, map.m_nodes)
+        writer->writeNode(node);
+
+    foreach(const EdgeData &edge, map.m_edges)
+        writer->writeEdge(edge);
+
+    if (!writer->end())
+    {
+        QFile::remove(tempFileName);
+        return QObject::tr("Couldn't write file.");
+    }
+
+    if (!replaceFile(&file, fileName))
+        return QObject::tr("Couldn't replace file.");
+
+    return QString();
+}
+
+bool MapWriter::replaceFile(QFile *file, const QString &fileName)
+{
+    const QString tempFileName(file->fileName());
+
+    // the writers close the file, open it again for the sync
+    bool ok(true);
+#ifdef Q_OS_UNIX
+    ok = file->open(QIODevice::ReadOnly) && ::fsync(file->handle()) == 0;
+    file->close();
+    ok = ok && ::rename(QFile::encodeName(tempFileName).constData(),
+                        QFile::encodeName(fileName).constData()) == 0;
+#else
+    QFile::remove(fileName);
+    ok = QFile::rename(tempFileName, fileName);
+#endif
+    if (!ok)
+        QFile::remove(tempFileName);
+
+    return ok;
+}
+
+bool MapWriter::convert(const QString &sourceFileName,
+                        const QString &destinationFileName,
+                        QString *errorString)
+{
+    QScopedPointer<MapReader> reader(MapReader::open(sourceFileName));
+    if (!reader)
+    {
+        if (errorString)
+            *errorString = QObject::tr("Couldn't read file.");
+        return false;
+    }
+
+    // a failed conversion leaves no partial file behind
+    QFile file(destinationFileName + ".saving");
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        if (errorString)
+            *errorString = QObject::tr("Couldn't open file to write.");
+        return false;
+    }
+
+    // both formats list the nodes first, records can be copied one by one
+    QScopedPointer<MapWriter> writer(
+                create(&file, formatOfFileName(destinationFileName)));
+    writer->begin();
+
+    MapReader::TokenType token;
+    while ((token = reader->readNext()) != MapReader::EndOfMap &&
+           !reader->hasError())
+    {
+        if (token == MapReader::NodeRecord)
+        {
+            writer->writeNode(reader->node());
+        }
+        else
+        {
+            writer->writeEdge(reader->edge());
+        }
+    }
+
+    if (reader->hasError())
+    {
+        if (errorString)
+            *errorString = reader->errorString();
+        file.remove();
+        return false;
+    }
+
+    if (!writer->end())
+    {
+        if (errorString)
+            *errorString = QObject::tr("Couldn't write file.");
+        file.remove();
+        return false;
+    }
+
+    if (!replaceFile(&file, destinationFileName))
+    {
+        if (errorString)
+            *errorString = QObject::tr("Couldn't replace file.");
+        return false;
+    }
+
+    return true;
+}
+
+XmlMapWriter::XmlMapWriter(QIODevice *device)
+    : MapWriter(device)
+    , m_xml(device)
+    , m_writingNodes(true)
+{
+    m_xml.setAutoFormatting(true);
+    m_xml.setAutoFormattingIndent(1);
+}
+
+void XmlMapWriter::begin()
+{
+    m_xml.writeStartDocument();
+    m_xml.writeDTD("<!DOCTYPE QtMindMap>");
+    m_xml.writeStartElement("qtmindmap");
+    m_xml.writeStartElement("nodes");
+    m_writingNodes = true;
+}
+
+void XmlMapWriter::writeNode(const NodeData &node)
+{
+    m_xml.writeEmptyElement("node");
+    m_xml.writeAttribute("id", QString::number(node.m_id));
+    m_xml.writeAttribute("x", QString::number(node.m_x));
+    m_xml.writeAttribute("y", QString::number(node.m_y));
+    switch (node.m_contentType)
+    {
+    case NodeData::PlainText:
+        m_xml.writeAttribute("text", node.m_content);
+        break;
+    case NodeData::HtmlFragment:
+        m_xml.writeAttribute("html", node.m_content);
+        break;
+    default:
+        m_xml.writeAttribute("htmlContent", node.m_content);
+        break;
+    }
+
+    m_xml.writeAttribute("scale", QString::number(node.m_scale));
+    m_xml.writeAttribute("bg_red", QString::number(mapColorRed(node.m_color)));
+    m_xml.writeAttribute("bg_green",
+                         QString::number(mapColorGreen(node.m_color)));
+    m_xml.writeAttribute("bg_blue",
+                         QString::number(mapColorBlue(node.m_color)));
+    m_xml.writeAttribute("text_red",
+                         QString::number(mapColorRed(node.m_textColor)));
+    m_xml.writeAttribute("text_green",
+                         QString::number(mapColorGreen(node.m_textColor)));
+    m_xml.writeAttribute("text_blue",
+                         QString::number(mapColorBlue(node.m_textColor)));
+}
+
+void XmlMapWriter::writeEdge(const EdgeData &edge)
+{
+    // the first edge closes the nodes
+    if (m_writingNodes)
+    {
+        m_xml.writeEndElement();
+        m_xml.writeStartElement("edges");
+        m_writingNodes = false;
+    }
+
+    m_xml.writeEmptyElement("edge");
+    m_xml.writeAttribute("source", QString::number(edge.m_source));
+    m_xml.writeAttribute("destination", QString::number(edge.m_destination));
+    m_xml.writeAttribute("red", QString::number(mapColorRed(edge.m_color)));
+    m_xml.writeAttribute("green", QString::number(mapColorGreen(edge.m_color)));
+    m_xml.writeAttribute("blue", QString::number(mapColorBlue(edge.m_color)));
+    m_xml.writeAttribute("width", QString::number(edge.m_width));
+    m_xml.writeAttribute("secondary", QString::number(edge.m_secondary));
+}
+
+bool XmlMapWriter::end()
+{
+    if (m_writingNodes)
+    {
+        m_xml.writeEndElement();
+        m_xml.writeStartElement("edges");
+        m_writingNodes = false;
+    }
+
+    m_xml.writeEndDocument();
+
+    QFile *file = qobject_cast<QFile *>(m_device);
+    if (file)
+    {
+        file->close();
+        return file->error() == QFile::NoError;
+    }
+
+    return true;
+}
+
+// little endian IEEE 754 double to the record
+static void writeDouble(const qreal &value, uchar *dest)
+{
+    double d(value);
+    quint64 bits;
+    memcpy(&bits, &d, sizeof(bits));
+    qToLittleEndian<quint64>(bits, dest);
+}
+
+BinaryMapWriter::BinaryMapWriter(QIODevice *device)
+    : MapWriter(device)
+    , m_heapSize(0)
+    , m_ok(true)
+{
+}
+
+void BinaryMapWriter::begin()
+{
+    // the header is written at the end when all the sizes are known,
+    // the string heap is streamed right after its place
+    m_nodeTable.clear();
+    m_edgeTable.clear();
+    m_heapSize = 0;
+    m_ok = m_device->seek(BinaryLayout::headerSize);
+}
+
+void BinaryMapWriter::writeNode(const NodeData &node)
+{
+    using namespace BinaryLayout;
+
+    int pos = m_nodeTable.size();
+    m_nodeTable.resize(pos + nodeRecordSize);
+    uchar *record = reinterpret_cast<uchar *>(m_nodeTable.data()) + pos;
+    memset(record, 0, nodeRecordSize);
+
+    qToLittleEndian<qint32>(node.m_id, record + NodeIdOffset);
+    qToLittleEndian<quint32>(node.m_color, record + NodeColorOffset);
+    qToLittleEndian<quint32>(node.m_textColor, record + NodeTextColorOffset);
+    qToLittleEndian<quint32>(m_heapSize, record + NodeContentOffset);
+    qToLittleEndian<quint32>(node.m_content.size(),
+                             record + NodeContentLengthOffset);
+    qToLittleEndian<quint32>(node.m_contentType,
+                             record + NodeContentTypeOffset);
+    writeDouble(node.m_x, record + NodeXOffset);
+    writeDouble(node.m_y, record + NodeYOffset);
+    writeDouble(node.m_scale, record + NodeScaleOffset);
+
+    // content to the heap as UTF-16
+    qint64 bytes = node.m_content.size() * 2;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    m_ok = m_ok && m_device->write(
+                reinterpret_cast<const char *>(node.m_content.constData()),
+                bytes) == bytes;
+#else
+    QByteArray content;
+    content.resize(bytes);
+    for (int i = 0; i < node.m_content.size(); i++)
+        qToLittleEndian<quint16>(node.m_content.at(i).unicode(),
+                         reinterpret_cast<uchar *>(content.data()) + i * 2);
+    m_ok = m_ok && m_device->write(content) == bytes;
+#endif
+    m_heapSize += bytes;
+}
+
+void BinaryMapWriter::writeEdge(const EdgeData &edge)
+{
+    using namespace BinaryLayout;
+
+    int pos = m_edgeTable.size();
+    m_edgeTable.resize(pos + edgeRecordSize);
+    uchar *record = reinterpret_cast<uchar *>(m_edgeTable.data()) + pos;
+    memset(record, 0, edgeRecordSize);
+
+    qToLittleEndian<qint32>(edge.m_source, record + EdgeSourceOffset);
+    qToLittleEndian<qint32>(edge.m_destination,
+                            record + EdgeDestinationOffset);
+    qToLittleEndian<quint32>(edge.m_color, record + EdgeColorOffset);
+    qToLittleEndian<quint32>(edge.m_secondary ? secondaryFlag : 0,
+                             record + EdgeFlagsOffset);
+    writeDouble(edge.m_width, record + EdgeWidthOffset);
+}
+
+bool BinaryMapWriter::end()
+{
+    using namespace BinaryLayout;
+
+    // keep the tables 8 byte aligned after the heap
+    quint32 heapEnd = headerSize + m_heapSize;
+    quint32 nodeTableOffset = (heapEnd + 7) & ~7u;
+    quint32 edgeTableOffset = nodeTableOffset + m_nodeTable.size();
+
+    QByteArray header(headerSize, '\0');
+    uchar *h = reinterpret_cast<uchar *>(header.data());
+    memcpy(h + MagicOffset, magic, 4);
+    qToLittleEndian<quint32>(version, h + VersionOffset);
+    qToLittleEndian<quint32>(m_nodeTable.size() / nodeRecordSize,
+                             h + NodeCountOffset);
+    qToLittleEndian<quint32>(m_edgeTable.size() / edgeRecordSize,
+                             h + EdgeCountOffset);
+    qToLittleEndian<quint32>(headerSize, h + HeapOffsetOffset);
+    qToLittleEndian<quint32>(m_heapSize, h + HeapSizeOffset);
+    qToLittleEndian<quint32>(nodeTableOffset, h + NodeTableOffsetOffset);
+    qToLittleEndian<quint32>(edgeTableOffset, h + EdgeTableOffsetOffset);
+
+    m_ok = m_ok &&
+            m_device->write(QByteArray(nodeTableOffset - heapEnd, '\0')) ==
+                qint64(nodeTableOffset - heapEnd) &&
+            m_device->write(m_nodeTable) == m_nodeTable.size() &&
+            m_device->write(m_edgeTable) == m_edgeTable.size() &&
+            m_device->seek(0) &&
+            m_device->write(header) == header.size();
+
+    QFile *file = qobject_cast<QFile *>(m_device);
+    if (file)
+    {
+        file->close();
+        m_ok = m_ok && file->error() == QFile::NoError;
+    }
+
+    return m_ok;
+}
@@ -3,11 +3,16 @@
 #include <QPainter>
 #include <QStyleOption>
 #include <QDebug>
+#include <QSet>
 #include <QGraphicsSceneMouseEvent>
 #include <QTextDocument>
+#include <QAbstractTextDocumentLayout>
+#include <QTextBlock>
+#include <QTextLayout>
+
+#include "include/layoutmath.h"
 
 const QPointF Node::newNodeCenter = QPointF(4, 11.5);
-const QPointF Node::newNodeBottomRigth = QPointF(8, 23);
 
 const double Node::m_pi = 3.14159265358979323846264338327950288419717;
 const double Node::m_oneAndHalfPi = Node::m_pi * 1.5;
@@ -15,99 +20,114 @@ const double Node::m_twoPi = Node::m_pi * 2.0;
 
 const QColor Node::m_gold(255,215,0);
 
+const qreal Node::m_shapeXRadius = 20.0;
+const qreal Node::m_shapeYRadius = 15.0;
+
+const qreal Node::m_boxDetail = 0.25;
+const qreal Node::m_textDetail = 0.6;
+
 Node::Node(GraphLogic *graphLogic)
     : m_graphLogic(graphLogic)
+    , m_id(-1)
     , m_number(-1)
     , m_hasBorder(false)
     , m_numberIsSpecial(false)
     , m_color(m_gold)
     , m_textColor(0,0,0)
-    , m_effect(new QGraphicsDropShadowEffect(this))
+    , m_content()
+    , m_contentType(NodeData::PlainText)
+    , m_contentValid(false)
+    , m_greekedLinesValid(false)
 {
     setFlag(ItemIsMovable);
     setFlag(ItemSendsGeometryChanges);
     setCacheMode(DeviceCoordinateCache);
     setDefaultTextColor(QColor(0,0,0));
     setZValue(2);
-    setGraphicsEffect(m_effect);
-    m_effect->setEnabled(false);
-    m_effect->setOffset(qreal(4.0));
+
+    connect(document(), SIGNAL(contentsChanged()),
+            this, SLOT(contentsChanged()));
+
+    // after QGraphicsTextItem has taken the new size
+    connect(document()->documentLayout(),
+            SIGNAL(documentSizeChanged(const QSizeF &)),
+            this, SLOT(documentSizeChanged()));
 }
 
 Node::~Node()
 {
+    if (scene())
+        m_graphLogic->nodeRemovedFromScene(this);
+
     deleteEdges();
 }
 
 void Node::addEdge(Edge *edge, bool startsFromThisNode)
 {
-    m_edgeList.push_back(EdgeElement(edge, startsFromThisNode));
-    edge->adjust();
+    const Node *otherEnd = startsFromThisNode ?
+                edge->destNode() :
+                edge->sourceNode();
+
+    // undo adds back the edges it has removed, do not count them twice
+    if (m_edgeOfNode.value(otherEnd) != edge)
+    {
+        m_edgeOfNode.insert(otherEnd, edge);
+        edgeListOf(edge)->append(edge);
+        m_graphLogic->subtreeIndex()->invalidate();
+    }
+
+    edge->adjustLater();
 }
 
 void Node::deleteEdge(Node *otherEnd)
 {
-    for(QList<EdgeElement>::iterator it = m_edgeList.begin();
-        it != m_edgeList.end(); it++)
-    {
-        if ((it->edge->sourceNode() == otherEnd &&
-             it->edge->destNode() == this)
-         || (it->edge->sourceNode() == this &&
-             it->edge->destNode() == otherEnd))
-        {
-            delete it->edge;
-            return;
-        }
-    }
+    delete m_edgeOfNode.value(otherEnd);
 }
 
 void Node::deleteEdges()
 {
-    foreach (EdgeElement element, m_edgeList)
-        delete element.edge;
+    // the destructor of the Edge removes it from the lists
+    qDeleteAll(edges());
 }
 
 void Node::removeEdge(Edge *edge)
 {
-    for(QList<EdgeElement>::iterator it = m_edgeList.begin();
-        it != m_edgeList.end(); it++)
-    {
-        if (it->edge == edge)
-        {
-            m_edgeList.erase(it);
-            return;
-        }
-    }
+    const Node *otherEnd = edge->sourceNode() == this ?
+                edge->destNode() :
+                edge->sourceNode();
+
+    if (m_edgeOfNode.value(otherEnd) != edge)
+        return;
+
+    m_edgeOfNode.remove(otherEnd);
+    edgeListOf(edge)->removeOne(edge);
+    m_graphLogic->subtreeIndex()->invalidate();
 }
 
 void Node::removeEdges()
 {
-    for(QList<EdgeElement>::iterator it = m_edgeList.begin();
-        it != m_edgeList.end(); it++)
-    {
-        m_edgeList.erase(it);
-    }
+    m_edgeOfNode.clear();
+    m_childEdges.clear();
+    m_parentEdges.clear();
+    m_secondaryEdges.clear();
+    m_graphLogic->subtreeIndex()->invalidate();
 }
 
 QList<Edge *> Node::edges() const
 {
-    QList<Edge *> list;
-
-    foreach(EdgeElement element, m_edgeList)
-        list.push_back(element.edge);
-
-    return list;
+    return m_childEdges + m_parentEdges + m_secondaryEdges;
 }
 
 // edges from this Node. Exclude secondaries if needed (calc subtree)
 QList<Edge *> Node::edgesFrom(const bool &excludeSecondaries) const
 {
-    QList<Edge *> list;
+    if (excludeSecondaries)
+        return m_childEdges;
 
-    foreach(EdgeElement element, m_edgeList)
-        if (element.startsFromThisNode &&
-                (!element.edge->secondary() || !excludeSecondaries))
-            list.push_back(element.edge);
+    QList<Edge *> list = m_childEdges;
+    foreach(Edge *edge, m_secondaryEdges)
+        if (edge->sourceNode() == this)
+            list.push_back(edge);
 
     return list;
 }
@@ -115,28 +135,55 @@ QList<Edge *> Node::edgesFrom(const bool &excludeSecondaries) const
 // edges to this node (max 1 primary and any number of secondaries)
 QList<Edge *> Node::edgesToThis(const bool &excludeSecondaries) const
 {
-    QList<Edge *> list;
+    if (excludeSecondaries)
+        return m_parentEdges;
 
-    foreach(EdgeElement element, m_edgeList)
-        if (!element.startsFromThisNode &&
-                (!element.edge->secondary() || !excludeSecondaries))
-            list.push_back(element.edge);
+    QList<Edge *> list = m_parentEdges;
+    foreach(Edge *edge, m_secondaryEdges)
+        if (edge->destNode() == this)
+            list.push_back(edge);
 
     return list;
 }
 
+const QList<Edge *> &Node::childEdges() const
+{
+    return m_childEdges;
+}
+
+const QList<Edge *> &Node::parentEdges() const
+{
+    return m_parentEdges;
+}
+
+const QList<Edge *> &Node::secondaryEdges() const
+{
+    return m_secondaryEdges;
+}
+
+int Node::edgeCount() const
+{
+    return m_edgeOfNode.size();
+}
+
 // the edge from this Node to the parameter Node
 Edge * Node::edgeTo(const Node *node) const
 {
-    foreach(EdgeElement element, m_edgeList)
-        if ((element.edge->sourceNode() == node  ||
-             element.edge->destNode() == node))
-            return element.edge;
-
-    return 0;
+    return m_edgeOfNode.value(node, 0);
 }
 
 QList<Node *> Node::subtree() const
+{
+    SubtreeIndex *index = m_graphLogic->subtreeIndex();
+    if (index->useForQuery() && index->contains(this))
+        return index->subtree(this);
+
+    return collectSubtree();
+}
+
+// traversal for the Nodes which are not in the scene and for the queries
+// between the edits of the tree
+QList<Node *> Node::collectSubtree() const
 {
     /** @note QList crashes if modified while traversal,
       * QMutableListIterator lacks push_back, using good old std::list
@@ -150,32 +197,110 @@ QList<Node *> Node::subtree() const
         it != list.end();
         it++)
     {
-        QList<Edge *> edges = (*it)->edgesFrom();
-        foreach(Edge *edge, edges)
-            if (!edge->secondary())
-                list.push_back( edge->destNode() != this ?
-                                   edge->destNode():
-                                   edge->sourceNode());
+        foreach(Edge *edge, (*it)->m_childEdges)
+            list.push_back(edge->destNode());
     }
 
     return QList<Node *>::fromStdList(list);
 }
 
-// return thue if this and the parameter Node is connected with an edge
-bool Node::isConnected(const Node *node) const
+// up the primary edges, an edit of the tree does not renumber the index
+bool Node::isInSubtreeOf(const Node *root) const
 {
-    foreach (EdgeElement element, m_edgeList)
-        if (element.edge->sourceNode() == node ||
-                element.edge->destNode() == node)
+    QList<const Node *> path;
+    QSet<const Node *> visited;
+    path.append(this);
+
+    while (!path.isEmpty())
+    {
+        const Node *node = path.takeLast();
+        if (node == root)
             return true;
 
+        // a loop of primary edges must not hang the walk
+        if (visited.contains(node))
+            continue;
+
+        visited.insert(node);
+        foreach(Edge *edge, node->m_parentEdges)
+            path.append(edge->sourceNode());
+    }
+
     return false;
 }
 
+// return thue if this and the parameter Node is connected with an edge
+bool Node::isConnected(const Node *node) const
+{
+    return m_edgeOfNode.contains(node);
+}
+
+// an Edge changing between primary and secondary is moved to the other list
+void Node::edgeSecondaryChanged(Edge *edge)
+{
+    const Node *otherEnd = edge->sourceNode() == this ?
+                edge->destNode() :
+                edge->sourceNode();
+
+    if (m_edgeOfNode.value(otherEnd) != edge)
+        return;
+
+    if (edge->secondary())
+    {
+        (edge->sourceNode() == this ?
+             m_childEdges : m_parentEdges).removeOne(edge);
+        m_secondaryEdges.append(edge);
+    }
+    else
+    {
+        m_secondaryEdges.removeOne(edge);
+        (edge->sourceNode() == this ?
+             m_childEdges : m_parentEdges).append(edge);
+    }
+
+    m_graphLogic->subtreeIndex()->invalidate();
+}
+
+QList<Edge *> *Node::edgeListOf(Edge *edge)
+{
+    if (edge->secondary())
+        return &m_secondaryEdges;
+
+    return edge->sourceNode() == this ? &m_childEdges : &m_parentEdges;
+}
+
+void Node::adjustEdges()
+{
+    foreach(Edge *edge, m_childEdges)
+        edge->adjustLater();
+
+    foreach(Edge *edge, m_parentEdges)
+        edge->adjustLater();
+
+    foreach(Edge *edge, m_secondaryEdges)
+        edge->adjustLater();
+}
+
+GraphLogic *Node::graphLogic() const
+{
+    return m_graphLogic;
+}
+
+int Node::id() const
+{
+    return m_id;
+}
+
+// persistent identifier of the Node in the saved map, see GraphLogic
+void Node::setId(const int &id)
+{
+    m_id = id;
+}
+
 void Node::setBorder(const bool &hasBorder)
 {
    m_hasBorder = hasBorder;
-   m_effect->setEnabled(hasBorder);
+   m_graphLogic->nodeBorderChanged(this, hasBorder);
 
    update();
 }
@@ -218,24 +343,152 @@ QColor Node::textColor() const
     return m_textColor;
 }
 
-void Node::setScale(const qreal &factor,const QRectF &sceneRect)
+// saving calls it for every Node, regenerate only the changed ones
+QString Node::content(NodeData::ContentType *type) const
 {
-    // cannot scale out the Node from the scene
-    if (!sceneRect.contains(pos() +
-                            boundingRect().bottomRight() * scale() * factor))
-        return;
+    if (!m_contentValid)
+    {
+        m_content = compactContent(document(), &m_contentType);
+        m_contentValid = true;
+    }
+
+    *type = m_contentType;
+    return m_content;
+}
+
+void Node::setContent(const NodeData::ContentType &type,
+                      const QString &content)
+{
+    setDocumentContent(document(), type, content);
+}
+
+// plain text if the document looks like one set by setPlainText()
+static bool hasFormatting(const QTextDocument *document)
+{
+    const QFont font = document->defaultFont();
+    for (QTextBlock block = document->begin();
+         block.isValid();
+         block = block.next())
+    {
+        QTextBlockFormat blockFormat = block.blockFormat();
+        if (block.textList() ||
+            (blockFormat.alignment() & Qt::AlignHorizontal_Mask) !=
+                Qt::AlignLeft ||
+            blockFormat.topMargin() != 0 ||
+            blockFormat.bottomMargin() != 0 ||
+            blockFormat.leftMargin() != 0 ||
+            blockFormat.rightMargin() != 0 ||
+            blockFormat.indent() != 0 ||
+            blockFormat.textIndent() != 0 ||
+            blockFormat.hasProperty(QTextFormat::BackgroundBrush))
+            return true;
+
+        for (QTextBlock::iterator it = block.begin(); !it.atEnd(); ++it)
+        {
+            QTextCharFormat format = it.fragment().charFormat();
+            if (format.isImageFormat() ||
+                format.isAnchor() ||
+                format.hasProperty(QTextFormat::ForegroundBrush) ||
+                format.hasProperty(QTextFormat::BackgroundBrush) ||
+                format.verticalAlignment() !=
+                    QTextCharFormat::AlignNormal ||
+                (format.hasProperty(QTextFormat::FontFamily) &&
+                 format.fontFamily() != font.family()) ||
+                (format.hasProperty(QTextFormat::FontPointSize) &&
+                 format.fontPointSize() != font.pointSizeF()) ||
+                (format.hasProperty(QTextFormat::FontWeight) &&
+                 format.fontWeight() != font.weight()) ||
+                format.fontItalic() != font.italic() ||
+                format.fontUnderline() != font.underline() ||
+                format.fontStrikeOut() != font.strikeOut() ||
+                format.fontOverline() != font.overline())
+                return true;
+        }
+    }
+
+    return false;
+}
+
+// the part of QTextDocument::toHtml() before the content of <body>,
+// without the font of the body, that is the default font of the Node
+static const char fragmentHeader[] =
+        "<html><head><meta name=\"qrichtext\" content=\"1\" />"
+        "<style type=\"text/css\">\np, li { white-space: pre-wrap; }\n"
+        "</style></head><body>";
+
+QString Node::compactContent(const QTextDocument *document,
+                             NodeData::ContentType *type)
+{
+    if (!hasFormatting(document))
+    {
+        *type = NodeData::PlainText;
+        return document->toPlainText();
+    }
 
+    QString html = document->toHtml();
+    int begin = html.indexOf("<body");
+    begin = begin == -1 ? -1 : html.indexOf('>', begin);
+    int end = html.lastIndexOf("</body>");
+    if (begin == -1 || end < begin)
+    {
+        *type = NodeData::HtmlDocument;
+        return html;
+    }
+
+    *type = NodeData::HtmlFragment;
+    return html.mid(begin + 1, end - begin - 1).trimmed();
+}
+
+void Node::setDocumentContent(QTextDocument *document,
+                              const NodeData::ContentType &type,
+                              const QString &content)
+{
+    switch (type)
+    {
+    case NodeData::PlainText:
+        document->setPlainText(content);
+        break;
+    case NodeData::HtmlFragment:
+        document->setHtml(QLatin1String(fragmentHeader) + content +
+                          QLatin1String("</body></html>"));
+        break;
+    default:
+        document->setHtml(content);
+        break;
+    }
+}
+
+void Node::setDocument(QTextDocument *document)
+{
+    // the old document is deleted by the text control
+    QGraphicsTextItem::setDocument(document);
+    document->setParent(this);
+    m_contentValid = false;
+    m_greekedLinesValid = false;
+
+    connect(document, SIGNAL(contentsChanged()),
+            this, SLOT(contentsChanged()));
+    connect(document->documentLayout(),
+            SIGNAL(documentSizeChanged(const QSizeF &)),
+            this, SLOT(documentSizeChanged()));
+    m_graphLogic->nodeGeometryChanged(this);
+}
+
+void Node::setScale(const qreal &factor)
+{
     prepareGeometryChange();
     QGraphicsTextItem::setScale(factor + scale());
+    m_graphLogic->nodeGeometryChanged(this);
 
     // scale edges to this Node too
-    foreach(EdgeElement element, m_edgeList)
-    {
-        if (!element.startsFromThisNode)
-            element.edge->setWidth(element.edge->width() + factor );
+    foreach(Edge *edge, m_parentEdges)
+        edge->setWidth(edge->width() + factor);
 
-        element.edge->adjust();
-    }
+    foreach(Edge *edge, m_secondaryEdges)
+        if (edge->destNode() == this)
+            edge->setWidth(edge->width() + factor);
+
+    adjustEdges();
 }
 
 void Node::showNumber(const int &number,
@@ -255,85 +508,65 @@ void Node::insertPicture(const QString &picture)
     c.insertHtml(QString("<img src=").append(picture).
                  append(" width=15 height=15></img>"));
 
-    foreach (EdgeElement element, m_edgeList) element.edge->adjust();
+    adjustEdges();
     emit nodeChanged();
 }
 
-QPointF Node::intersection(const QLineF &line, const bool &reverse) const
+void Node::contentsChanged()
 {
+    m_contentValid = false;
+    m_greekedLinesValid = false;
+}
 
-    /// @note What a pity, the following does not work,
-    /// doing it with brute (unaccurate) force
-
-    //    QPainterPath nodeShape(shape());
-    //    nodeShape.translate(pos());
-
-    //    QPainterPath l;
-    //    l.moveTo(line.p1());
-    //    l.lineTo(line.p2());
-
-    //    return nodeShape.intersected(l);
-
-
-    QPainterPath path;
-    path.addRoundedRect(sceneBoundingRect(), 28.0, 28.0);
+void Node::documentSizeChanged()
+{
+    m_graphLogic->nodeGeometryChanged(this);
+}
 
-    if (reverse)
-    {
-        for (qreal t = 1; t!=0; t-=0.01)
-            if (!path.contains(line.pointAt(t)))
-                return line.pointAt(t);
-    }
-    else
-    {
-        for (qreal t = 0; t!=1; t+=0.01)
-            if (!path.contains(line.pointAt(t)))
-                return line.pointAt(t);
-    }
+// the line starts from inside this Node, where does it leave the shape()?
+QPointF Node::intersection(const QLineF &line, const bool &reverse) const
+{
+    const QPointF origin(reverse ? line.p2() : line.p1());
+    const QPointF other(reverse ? line.p1() : line.p2());
 
-    return QPointF(0,0);
+    return LayoutMath::roundedRectExit(sceneBoundingRect(),
+                                       m_shapeXRadius * scale(),
+                                       m_shapeYRadius * scale(),
+                                       origin,
+                                       other - origin);
 }
 
 double Node::calculateBiggestAngle() const
 {
     // in no edge, return with 12 o'clock
-    if (m_edgeList.empty())
+    if (m_edgeOfNode.isEmpty())
         return Node::m_oneAndHalfPi;
 
     // if there is only one edge, return with it's extension
-    if (m_edgeList.size()==1)
-        return m_edgeList.first().startsFromThisNode ?
-                    Node::m_pi - m_edgeList.first().edge->angle() :
-                    Node::m_twoPi - m_edgeList.first().edge->angle();
+    if (m_edgeOfNode.size()==1)
+    {
+        const Edge *edge = *m_edgeOfNode.constBegin();
+        return edge->sourceNode() == this ?
+                    Node::m_pi - edge->angle() :
+                    Node::m_twoPi - edge->angle();
+    }
 
     // put angles of every edges from this node to a list
     QList<double> tmp;
-    for(QList<EdgeElement>::const_iterator it = m_edgeList.begin();
-        it != m_edgeList.end(); it++)
-    {
-        tmp.push_back(it->startsFromThisNode ?
-                 it->edge->angle() :
-                 doubleModulo(Node::m_pi + it->edge->angle(), Node::m_twoPi));
-    }
-    qSort(tmp.begin(), tmp.end());
+    foreach(Edge *edge, m_childEdges)
+        tmp.push_back(edge->angle());
 
-    // find the biggest diffrence, store prev angle
-    double prev(tmp.first());
-    double max_prev(tmp.last());
-    double max(Node::m_twoPi - tmp.last() + tmp.first());
+    foreach(Edge *edge, m_parentEdges)
+        tmp.push_back(LayoutMath::modulo(Node::m_pi + edge->angle(),
+                                         Node::m_twoPi));
 
-    for(QList<double>::const_iterator it = ++tmp.begin(); it!=tmp.end(); it++)
-    {
-        if (*it - prev > max )
-        {
-            max = *it - prev;
-            max_prev = prev;
-        }
-        prev = *it;
-    }
+    foreach(Edge *edge, m_secondaryEdges)
+        tmp.push_back(edge->sourceNode() == this ?
+                 edge->angle() :
+                 LayoutMath::modulo(Node::m_pi + edge->angle(),
+                                    Node::m_twoPi));
 
-    // return with prev angle + max diff / 2
-    return Node::m_twoPi - doubleModulo(max_prev + max / 2, Node::m_twoPi);
+    return LayoutMath::biggestGapAngle(tmp);
 }
 
 void Node::keyPressEvent(QKeyEvent *event)
@@ -381,41 +614,45 @@ void Node::keyPressEvent(QKeyEvent *event)
         // not cursor movement: editing
         QGraphicsTextItem::keyPressEvent(event);
 
-        foreach (EdgeElement element, m_edgeList) element.edge->adjust();
+        adjustEdges();
         emit nodeChanged();
     }
 
     ///@note leaving editing mode is done with esc, handled by graphwidget
 }
 
+// the text is drawn only where it can be read, a smaller Node gets bars
+// instead of its lines or just a box
 void Node::paint(QPainter *painter,
                  const QStyleOptionGraphicsItem *option,
                  QWidget *w)
 {
-    // draw background in hint mode. num == -1 : not in hint mode
-    // if m_numberIsSpecial (can be selected with enter) bg is green, not yellow
-    if (m_number != -1)
+    const qreal detail =
+            option->levelOfDetailFromTransform(painter->worldTransform());
+
+    if (detail < m_boxDetail)
     {
-        painter->setPen(Qt::transparent);
-        painter->setBrush(m_numberIsSpecial ? Qt::green : Qt::yellow);
-        painter->drawRoundedRect(boundingRect(), 20.0, 15.0);
+        if (m_number == -1 && m_hasBorder)
+        {
+            painter->setPen(QPen(QBrush(Qt::black), 0)); // a pixel wide
+        }
+        else
+        {
+            painter->setPen(Qt::NoPen);
+        }
+
+        painter->setBrush(backgroundColor());
+        painter->drawRect(boundingRect());
+    }
+    else if (detail < m_textDetail)
+    {
+        paintShape(painter);
+        paintGreekedText(painter);
     }
     else
     {
-        m_hasBorder ?
-            painter->setPen(QPen(QBrush(Qt::black), 1)) : // border is scaled
-            painter->setPen(Qt::transparent);
-
-        painter->setBrush(m_color);
-        painter->drawRoundedRect(boundingRect(), 20.0, 15.0);
-
+        paintFull(painter, option, w);
     }
-    painter->setBrush(Qt::NoBrush);
-
-    // the text itself
-    setDefaultTextColor(m_textColor);
-    QGraphicsTextItem::paint(painter, option, w);
-
 
     // print num to topleft corner in hint mode.
     if (m_number != -1)
@@ -428,39 +665,101 @@ void Node::paint(QPainter *painter,
     }
 }
 
-QVariant Node::itemChange(GraphicsItemChange change, const QVariant &value)
+void Node::paintFull(QPainter *painter,
+                     const QStyleOptionGraphicsItem *option,
+                     QWidget *w)
 {
-    switch (change) {
+    paintShape(painter);
+    painter->setBrush(Qt::NoBrush);
 
-    case ItemPositionChange:
+    // the text itself
+    setDefaultTextColor(m_textColor);
+    QGraphicsTextItem::paint(painter, option, w);
+}
+
+void Node::paintShape(QPainter *painter)
+{
+    // draw background in hint mode. num == -1 : not in hint mode
+    if (m_number == -1 && m_hasBorder)
     {
-        // Node is about to move, check borders
-        QPointF newPos = value.toPointF();
+        painter->setPen(QPen(QBrush(Qt::black), 1)); // border is scaled
+    }
+    else
+    {
+        painter->setPen(Qt::transparent);
+    }
 
-        // the fence is reduced with the size of the node
-        QRectF rect (scene()->sceneRect().topLeft(),
-                     scene()->sceneRect().bottomRight() -
-                     boundingRect().bottomRight() * scale() );
+    painter->setBrush(backgroundColor());
+    painter->drawRoundedRect(boundingRect(), m_shapeXRadius, m_shapeYRadius);
+}
 
-        if (!rect.contains(newPos))
+// a bar over the middle of each line, as wide as its text
+void Node::paintGreekedText(QPainter *painter)
+{
+    if (!m_greekedLinesValid)
+    {
+        m_greekedLines.clear();
+        for (QTextBlock block = document()->begin(); block.isValid();
+             block = block.next())
         {
-            // Keep the item inside the scene rect.
-            newPos.setX(qMin(rect.right(), qMax(newPos.x(), rect.left())));
-            newPos.setY(qMin(rect.bottom(), qMax(newPos.y(), rect.top())));
-            return newPos;
+            const QTextLayout *layout = block.layout();
+            for (int i = 0; i < layout->lineCount(); i++)
+            {
+                const QTextLine line = layout->lineAt(i);
+                if (line.naturalTextWidth() <= 0)
+                    continue;
+
+                m_greekedLines.append(
+                        QRectF(layout->position() +
+                               QPointF(line.x(),
+                                       line.y() + line.height() * 0.3),
+                               QSizeF(line.naturalTextWidth(),
+                                      line.height() * 0.4)));
+            }
         }
 
-         /// undo call here
-
-        break;
+        m_greekedLinesValid = true;
     }
+
+    QColor color(m_textColor);
+    color.setAlpha(128);
+    foreach(const QRectF &line, m_greekedLines)
+        painter->fillRect(line, color);
+}
+
+// if m_numberIsSpecial (can be selected with enter) bg is green, not yellow
+QColor Node::backgroundColor() const
+{
+    if (m_number == -1)
+        return m_color;
+
+    return m_numberIsSpecial ? Qt::green : Qt::yellow;
+}
+
+QVariant Node::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+    switch (change) {
+
     case ItemPositionHasChanged:
 
         // Notify parent, adjust edges that a move has happended.
-        foreach (EdgeElement element, m_edgeList) element.edge->adjust();
+        m_graphLogic->nodeGeometryChanged(this);
+        adjustEdges();
         emit nodeChanged();
         break;
 
+    case ItemSceneHasChanged:
+
+        if (scene())
+        {
+            m_graphLogic->nodeAddedToScene(this);
+        }
+        else
+        {
+            m_graphLogic->nodeRemovedFromScene(this);
+        }
+        break;
+
     default:
         break;
     };
@@ -472,6 +771,12 @@ void Node::mousePressEvent(QGraphicsSceneMouseEvent *event)
 {
     emit nodeSelected();
 
+    // Ctrl+Shift drags the subtree too
+    if (event->button() == Qt::LeftButton)
+        m_graphLogic->beginDrag(this,
+                                event->modifiers() & Qt::ControlModifier &&
+                                event->modifiers() & Qt::ShiftModifier);
+
     QGraphicsItem::mousePressEvent(event);
 }
 
@@ -484,6 +789,8 @@ void Node::mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event)
 
 void Node::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
 {
+    m_graphLogic->endDrag();
+
     QGraphicsItem::mouseReleaseEvent(event);
 }
 
@@ -491,13 +798,13 @@ void Node::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
 void Node::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
 {
     QPointF diff(event->scenePos() - event->lastScenePos());
-    m_graphLogic->moveNode(diff.x(), diff.y());
+    m_graphLogic->drag(diff.x(), diff.y());
 }
 
-QPainterPath Node::shape () const
+QPainterPath Node::shape() const
 {
     QPainterPath path;
-    path.addRoundedRect(boundingRect(), 20.0, 15.0);
+    path.addRoundedRect(boundingRect(), m_shapeXRadius, m_shapeYRadius);
     return path;
 }
 
@@ -509,10 +816,3 @@ void Node::focusOutEvent(QFocusEvent *event)
 
     emit nodeLostFocus();
 }
-
-// there is no such thing as modulo operator for double :P
-double Node::doubleModulo(const double &devided, const double &devisor) const
-{
-    return devided - static_cast<double>(devisor * static_cast<int>(devided
-                                                                  / devisor));
-}
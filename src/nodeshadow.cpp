@@ -0,0 +1,67 @@
+#include "include/nodeshadow.h"
+
+#include <QPainter>
+#include <QGraphicsScene>
+
+#include "include/node.h"
+
+// the look of the QGraphicsDropShadowEffect the Nodes had
+const QColor NodeShadow::m_color(63, 63, 63, 180);
+const QPointF NodeShadow::m_offset(4, 4);
+
+NodeShadow::NodeShadow()
+{
+    // does not interact with user, between the Edges and the Nodes
+    setAcceptedMouseButtons(0);
+    setZValue(1.5);
+    hide();
+}
+
+void NodeShadow::setNode(Node *node)
+{
+    m_node = node;
+    if (!node)
+    {
+        hide();
+        return;
+    }
+
+    if (node->scene() && node->scene() != scene())
+        node->scene()->addItem(this);
+
+    updateGeometry();
+    show();
+}
+
+Node *NodeShadow::node() const
+{
+    return m_node;
+}
+
+void NodeShadow::updateGeometry()
+{
+    if (!m_node)
+        return;
+
+    prepareGeometryChange();
+    m_shape = m_node->shape();
+    setPos(m_node->pos() + m_offset);
+    setScale(m_node->scale());
+}
+
+QRectF NodeShadow::boundingRect() const
+{
+    return m_shape.boundingRect();
+}
+
+void NodeShadow::paint(QPainter *painter,
+                       const QStyleOptionGraphicsItem *option,
+                       QWidget *widget)
+{
+    Q_UNUSED(option);
+    Q_UNUSED(widget);
+
+    painter->setPen(Qt::NoPen);
+    painter->setBrush(m_color);
+    painter->drawPath(m_shape);
+}
@@ -0,0 +1,165 @@
+#include "include/pngwriter.h"
+
+#include <QtEndian>
+
+#include <string.h>
+
+PngWriter::PngWriter(QIODevice *device, const int &width, const int &height,
+                     const int &dpi)
+    : m_device(device)
+    , m_width(width)
+    , m_height(height)
+    , m_dpi(dpi)
+    , m_row(0)
+    , m_ok(true)
+    , m_started(false)
+    , m_outputSize(0)
+{
+    memset(&m_stream, 0, sizeof(m_stream));
+}
+
+PngWriter::~PngWriter()
+{
+    if (m_started)
+        deflateEnd(&m_stream);
+}
+
+bool PngWriter::begin()
+{
+    if (m_width <= 0 || m_height <= 0 || m_dpi <= 0)
+        return false;
+
+    static const char signature[8] =
+        { '\x89', 'P', 'N', 'G', '\r', '\n', '\x1a', '\n' };
+    m_ok = m_device->write(signature, 8) == 8;
+
+    // 8 bit truecolor, no interlace
+    uchar header[13];
+    qToBigEndian<quint32>(m_width, header);
+    qToBigEndian<quint32>(m_height, header + 4);
+    header[8] = 8;
+    header[9] = 2;
+    header[10] = 0;
+    header[11] = 0;
+    header[12] = 0;
+    writeChunk("IHDR", reinterpret_cast<const char *>(header), 13);
+
+    // physical size: pixels per metre in both directions
+    uchar physical[9];
+    quint32 perMetre = quint32(m_dpi / 0.0254 + 0.5);
+    qToBigEndian<quint32>(perMetre, physical);
+    qToBigEndian<quint32>(perMetre, physical + 4);
+    physical[8] = 1;
+    writeChunk("pHYs", reinterpret_cast<const char *>(physical), 9);
+
+    if (deflateInit(&m_stream, Z_DEFAULT_COMPRESSION) != Z_OK)
+        return false;
+
+    m_started = true;
+    m_rowBuffer.resize(1 + m_width * 3);
+    m_output.resize(m_chunkSize);
+    m_outputSize = 0;
+
+    return m_ok;
+}
+
+bool PngWriter::writeRow(const quint32 *pixels)
+{
+    if (!m_started || m_row == m_height)
+        return false;
+
+    // the Sub filter: difference to the pixel on the left,
+    // the paper and the flat node colors become runs of zeros
+    uchar *row = reinterpret_cast<uchar *>(m_rowBuffer.data());
+    row[0] = 1;
+    quint32 left = 0;
+    for (int i = 0; i < m_width; i++)
+    {
+        quint32 pixel = pixels[i];
+        row[1 + i * 3] = uchar((pixel >> 16) - (left >> 16));
+        row[2 + i * 3] = uchar((pixel >> 8) - (left >> 8));
+        row[3 + i * 3] = uchar(pixel - left);
+        left = pixel;
+    }
+
+    m_row++;
+    return deflateRow(Z_NO_FLUSH);
+}
+
+bool PngWriter::end()
+{
+    if (!m_started || m_row != m_height)
+        return false;
+
+    deflateRow(Z_FINISH);
+    writeChunk("IDAT", m_output.constData(), m_outputSize);
+    writeChunk("IEND", 0, 0);
+
+    deflateEnd(&m_stream);
+    m_started = false;
+
+    return m_ok;
+}
+
+bool PngWriter::writeChunk(const char *type, const char *data,
+                           const int &size)
+{
+    uchar length[4];
+    qToBigEndian<quint32>(size, length);
+
+    uLong crc = crc32(0, reinterpret_cast<const Bytef *>(type), 4);
+    if (size)
+        crc = crc32(crc, reinterpret_cast<const Bytef *>(data), size);
+
+    uchar checksum[4];
+    qToBigEndian<quint32>(crc, checksum);
+
+    m_ok = m_ok &&
+            m_device->write(reinterpret_cast<const char *>(length), 4) == 4 &&
+            m_device->write(type, 4) == 4 &&
+            (!size || m_device->write(data, size) == size) &&
+            m_device->write(reinterpret_cast<const char *>(checksum), 4) == 4;
+
+    return m_ok;
+}
+
+bool PngWriter::deflateRow(const int &flush)
+{
+    if (flush == Z_FINISH)
+    {
+        m_stream.next_in = 0;
+        m_stream.avail_in = 0;
+    }
+    else
+    {
+        m_stream.next_in = reinterpret_cast<Bytef *>(m_rowBuffer.data());
+        m_stream.avail_in = m_rowBuffer.size();
+    }
+
+    // a full output buffer becomes an IDAT chunk
+    int result;
+    do
+    {
+        m_stream.next_out =
+                reinterpret_cast<Bytef *>(m_output.data()) + m_outputSize;
+        m_stream.avail_out = m_chunkSize - m_outputSize;
+
+        result = deflate(&m_stream, flush);
+        if (result == Z_STREAM_ERROR)
+        {
+            m_ok = false;
+            return false;
+        }
+
+        m_outputSize = m_chunkSize - m_stream.avail_out;
+        if (m_outputSize == m_chunkSize)
+        {
+            writeChunk("IDAT", m_output.constData(), m_outputSize);
+            m_outputSize = 0;
+        }
+    }
+    while (m_stream.avail_in > 0 ||
+           (flush == Z_FINISH && result != Z_STREAM_END));
+
+    return m_ok;
+}
@@ -0,0 +1,60 @@
+#include "include/scenesnapshot.h"
+
+#include <QGraphicsItem>
+#include <QPicture>
+#include <QStyleOptionGraphicsItem>
+
+SceneSnapshot::SceneSnapshot(QGraphicsScene *scene, const qreal &scale)
+    : m_scale(scale)
+{
+    QList<QGraphicsItem *> items = scene->items(Qt::AscendingOrder);
+    m_items.reserve(items.size());
+
+    foreach(QGraphicsItem *graphicsItem, items)
+    {
+        // the Edges drawn by an EdgeLayer have no contents
+        if (!graphicsItem->isVisible() ||
+            graphicsItem->flags() & QGraphicsItem::ItemHasNoContents)
+            continue;
+
+        // the state of the option is empty: no focus or selection marks
+        QStyleOptionGraphicsItem option;
+        option.rect = graphicsItem->boundingRect().toAlignedRect();
+        option.exposedRect = graphicsItem->boundingRect();
+
+        QPicture picture;
+        QPainter painter(&picture);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.scale(m_scale, m_scale);
+        painter.setTransform(graphicsItem->sceneTransform(), true);
+        graphicsItem->paint(&painter, &option, 0);
+        painter.end();
+
+        Item item;
+        item.m_bounds = graphicsItem->sceneBoundingRect();
+        item.m_picture = QByteArray(picture.data(), picture.size());
+        m_items.append(item);
+    }
+}
+
+void SceneSnapshot::render(QPainter *painter, const QRectF &source) const
+{
+    painter->save();
+    painter->setClipRect(source, Qt::IntersectClip);
+
+    // the pictures have the scale in them already
+    painter->scale(1 / m_scale, 1 / m_scale);
+
+    foreach(const Item &item, m_items)
+    {
+        if (!item.m_bounds.intersects(source))
+            continue;
+
+        // an own copy: playing a shared QPicture moves its read position
+        QPicture picture;
+        picture.setData(item.m_picture.constData(), item.m_picture.size());
+        painter->drawPicture(0, 0, picture);
+    }
+
+    painter->restore();
+}
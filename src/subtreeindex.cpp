@@ -0,0 +1,125 @@
+#include "include/subtreeindex.h"
+
+#include "include/node.h"
+#include "include/edge.h"
+
+const int SubtreeIndex::m_buildQueries = 3;
+
+SubtreeIndex::SubtreeIndex(const QList<Node *> *nodes)
+    : m_nodes(nodes)
+    , m_valid(false)
+    , m_staleQueries(0)
+{
+}
+
+void SubtreeIndex::invalidate()
+{
+    m_valid = false;
+    m_staleQueries = 0;
+}
+
+bool SubtreeIndex::useForQuery()
+{
+    if (m_valid)
+        return true;
+
+    return ++m_staleQueries > m_buildQueries;
+}
+
+bool SubtreeIndex::contains(const Node *node) const
+{
+    if (!m_valid)
+        build();
+
+    return m_position.contains(node);
+}
+
+int SubtreeIndex::subtreeSize(const Node *root) const
+{
+    return subtreeEnd(root) - subtreeBegin(root);
+}
+
+QList<Node *> SubtreeIndex::subtree(const Node *root) const
+{
+    QList<Node *> list;
+    Node * const *end = subtreeEnd(root);
+    for (Node * const *it = subtreeBegin(root); it != end; it++)
+        list.append(*it);
+
+    return list;
+}
+
+Node * const *SubtreeIndex::subtreeBegin(const Node *root) const
+{
+    if (!m_valid)
+        build();
+
+    const int position = m_position.value(root, -1);
+    if (position == -1)
+        return m_order.constData();
+
+    return m_order.constData() + position;
+}
+
+Node * const *SubtreeIndex::subtreeEnd(const Node *root) const
+{
+    if (!m_valid)
+        build();
+
+    const int position = m_position.value(root, -1);
+    if (position == -1)
+        return m_order.constData();
+
+    return m_order.constData() + m_end[position];
+}
+
+// depth first from every Node without a parent, without recursion:
+// a chain of Nodes can be longer than the stack
+void SubtreeIndex::build() const
+{
+    m_order.clear();
+    m_end.clear();
+    m_position.clear();
+    m_order.reserve(m_nodes->size());
+    m_end.reserve(m_nodes->size());
+    m_position.reserve(m_nodes->size());
+
+    QVector<Level> stack;
+    foreach(Node *root, *m_nodes)
+    {
+        if (!root->parentEdges().isEmpty())
+            continue;
+
+        Level level = { root, m_order.size(), 0 };
+        m_position.insert(root, m_order.size());
+        m_order.append(root);
+        m_end.append(-1);
+        stack.append(level);
+
+        while (!stack.isEmpty())
+        {
+            Level &top = stack.last();
+            const QList<Edge *> &children = top.m_node->childEdges();
+            if (top.m_nextChild == children.size())
+            {
+                m_end[top.m_position] = m_order.size();
+                stack.pop_back();
+                continue;
+            }
+
+            Node *child = children[top.m_nextChild++]->destNode();
+
+            // a loop of primary edges is numbered once
+            if (m_position.contains(child))
+                continue;
+
+            Level childLevel = { child, m_order.size(), 0 };
+            m_position.insert(child, m_order.size());
+            m_order.append(child);
+            m_end.append(-1);
+            stack.append(childLevel);
+        }
+    }
+
+    m_valid = true;
+}
@@ -3,11 +3,19 @@
 #include "algorithmtests.h"
 
 #include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QTextDocument>
+#include <QPainter>
+#include <qmath.h>
 
 #include "include/mainwindow.h"
 #include "include/graphwidget.h"
 #include "include/node.h"
 #include "include/edge.h"
+#include "include/journal.h"
+#include "include/mapwriter.h"
+#include "include/scenesnapshot.h"
 
 static const double Pi = 3.14159265358979323846264338327950288419717;
 
@@ -29,6 +37,40 @@ double angleOfPoints(const QPointF &a, const QPointF &b)
     return angle;
 }
 
+/** The walk Node::intersection() used to do, the oracle of the closed form:
+  * the first point of the line outside path, from its end if reverse
+  */
+static QPointF bruteForceIntersection(const QPainterPath &path,
+                                      const QLineF &line,
+                                      const bool &reverse,
+                                      const qreal &step = 0.01)
+{
+    const int steps = qRound(1 / step);
+    for (int i = 0; i <= steps; i++)
+    {
+        const qreal t = reverse ? 1 - i * step : i * step;
+        if (!path.contains(line.pointAt(t)))
+            return line.pointAt(t);
+    }
+
+    return QPointF(0,0);
+}
+
+// a Node in the scene of graphLogic with some text in it
+static Node *textNode(GraphLogic *graphLogic, const QPointF &pos,
+                      const qreal &scale)
+{
+    NodeData data;
+    data.m_id = graphLogic->m_nextNodeId;
+    data.m_x = pos.x();
+    data.m_y = pos.y();
+    data.m_scale = scale;
+    data.m_contentType = NodeData::PlainText;
+    data.m_content = "some text\nin two lines";
+
+    return graphLogic->createNode(data);
+}
+
 void AlgorithmTests::calculateBiggestAngle()
 {
     MainWindow *mainWindow = new MainWindow;
@@ -91,5 +133,863 @@ void AlgorithmTests::calculateBiggestAngle()
     delete mainWindow;
 }
 
+/** Node contents are stored in the shortest form,
+  * expanding it has to give back the same content
+  */
+void AlgorithmTests::compactContent()
+{
+    NodeData::ContentType type;
+    QTextDocument original;
+    QTextDocument expanded;
+
+    // a full toHtml() document of an old file without formatting
+    original.setPlainText("first line\nsecond  line");
+    QString oldHtml = original.toHtml();
+    original.setHtml(oldHtml);
+    QString content = Node::compactContent(&original, &type);
+    QCOMPARE(type, NodeData::PlainText);
+    QCOMPARE(content, QString("first line\nsecond  line"));
+
+    NodeData::ContentType expandedType;
+    Node::setDocumentContent(&expanded, type, content);
+    QCOMPARE(expanded.toPlainText(), original.toPlainText());
+    QCOMPARE(Node::compactContent(&expanded, &expandedType), content);
+    QCOMPARE(expandedType, type);
+
+    // bold text needs a fragment, without the header of the document
+    original.setHtml("<b>bold</b> and plain");
+    content = Node::compactContent(&original, &type);
+    QCOMPARE(type, NodeData::HtmlFragment);
+    QVERIFY(!content.contains("<body"));
+    QVERIFY(content.size() < original.toHtml().size());
+
+    Node::setDocumentContent(&expanded, type, content);
+    QCOMPARE(expanded.toPlainText(), original.toPlainText());
+    QCOMPARE(Node::compactContent(&expanded, &expandedType), content);
+    QCOMPARE(expandedType, type);
+
+    // old files still load
+    Node::setDocumentContent(&expanded, NodeData::HtmlDocument, oldHtml);
+    QCOMPARE(expanded.toPlainText(), QString("first line\nsecond  line"));
+}
+
+/** Every Edge is in the list of its kind at both ends
+  */
+void AlgorithmTests::adjacency()
+{
+    MainWindow *mainWindow = new MainWindow;
+    GraphWidget *graphWidget = new GraphWidget(mainWindow);
+    GraphLogic *graphLogic = graphWidget->graphLogic();
+
+    Node *parent = new Node(graphLogic);
+    Node *child = new Node(graphLogic);
+    Node *other = new Node(graphLogic);
+
+    Edge *primary = new Edge(parent, child);
+    parent->addEdge(primary, true);
+    child->addEdge(primary, false);
+
+    // adding it again, as undo does, does not duplicate it
+    child->addEdge(primary, false);
+
+    Edge *secondary = new Edge(other, child);
+    other->addEdge(secondary, true);
+    child->addEdge(secondary, false);
+    secondary->setSecondary();
+
+    QCOMPARE(parent->childEdges().size(), 1);
+    QCOMPARE(child->parentEdges().size(), 1);
+    QCOMPARE(child->secondaryEdges().size(), 1);
+    QCOMPARE(other->secondaryEdges().size(), 1);
+    QVERIFY(other->childEdges().isEmpty());
+    QCOMPARE(child->edgeCount(), 2);
+    QCOMPARE(child->edgeTo(other), secondary);
+    QCOMPARE(other->edgeTo(child), secondary);
+    QVERIFY(parent->isConnected(child));
+    QVERIFY(!parent->isConnected(other));
+    QCOMPARE(child->edgesToThis(false).size(), 2);
+    QCOMPARE(parent->subtree().size(), 2);
+
+    secondary->setSecondary(false);
+    QCOMPARE(other->childEdges().size(), 1);
+    QCOMPARE(child->parentEdges().size(), 2);
+    QVERIFY(child->secondaryEdges().isEmpty());
+
+    child->deleteEdge(parent);
+    QVERIFY(!parent->isConnected(child));
+    QVERIFY(parent->childEdges().isEmpty());
+    QCOMPARE(child->edgeCount(), 1);
+
+    delete child;
+    QCOMPARE(other->edgeCount(), 0);
+
+    delete parent;
+    delete other;
+    delete mainWindow;
+}
+
+/** The numbering follows the changes of the primary edges
+  */
+void AlgorithmTests::subtreeIndex()
+{
+    MainWindow *mainWindow = new MainWindow;
+    GraphWidget *graphWidget = new GraphWidget(mainWindow);
+    GraphLogic *graphLogic = graphWidget->graphLogic();
+
+    // base -> a -> b, base -> c
+    graphLogic->addFirstNode();
+    Node *base = graphLogic->m_activeNode;
+    NodeData data;
+    data.m_id = 1;
+    Node *a = graphLogic->createNode(data);
+    data.m_id = 2;
+    Node *b = graphLogic->createNode(data);
+    data.m_id = 3;
+    Node *c = graphLogic->createNode(data);
+    graphLogic->createEdge(EdgeData(), base, a);
+    graphLogic->createEdge(EdgeData(), a, b);
+    graphLogic->createEdge(EdgeData(), base, c);
+
+    // the queries right after the edits walk the tree, the later ones
+    // use the numbering
+    QList<Node *> subtree = base->subtree();
+    QCOMPARE(subtree.size(), 4);
+    QCOMPARE(subtree.first(), base);
+    QCOMPARE(a->subtree().size(), 2);
+    QVERIFY(!graphLogic->subtreeIndex()->m_valid);
+    for (int i = 0; i < SubtreeIndex::m_buildQueries; i++)
+        QCOMPARE(a->subtree().size(), 2);
+
+    QVERIFY(graphLogic->subtreeIndex()->m_valid);
+    subtree = base->subtree();
+    QCOMPARE(subtree.size(), 4);
+    QCOMPARE(subtree.first(), base);
+    QVERIFY(b->isInSubtreeOf(a));
+    QVERIFY(b->isInSubtreeOf(base));
+    QVERIFY(!c->isInSubtreeOf(a));
+    QVERIFY(!a->isInSubtreeOf(b));
+
+    // the loop check of a new edge does not number the tree again
+    graphLogic->subtreeIndex()->invalidate();
+    QVERIFY(b->isInSubtreeOf(base));
+    QVERIFY(!graphLogic->subtreeIndex()->m_valid);
+
+    // b becomes a root
+    a->deleteEdge(b);
+    QVERIFY(!b->isInSubtreeOf(base));
+    QCOMPARE(base->subtree().size(), 3);
+    QCOMPARE(b->subtree().size(), 1);
+
+    // a secondary edge does not count
+    EdgeData secondary;
+    secondary.m_secondary = true;
+    graphLogic->createEdge(secondary, c, b);
+    QVERIFY(!b->isInSubtreeOf(c));
+
+    graphLogic->removeAllNodes();
+    delete mainWindow;
+}
+
+/** A drag is one undo step, however many mouse moves it had
+  */
+void AlgorithmTests::dragGesture()
+{
+    MainWindow *mainWindow = new MainWindow;
+    GraphWidget *graphWidget = new GraphWidget(mainWindow);
+    GraphLogic *graphLogic = graphWidget->graphLogic();
+    QUndoStack stack;
+    graphLogic->setUndoStack(&stack);
+
+    graphLogic->addFirstNode();
+    Node *base = graphLogic->m_activeNode;
+    NodeData data;
+    data.m_id = 1;
+    data.m_x = 100;
+    Node *child = graphLogic->createNode(data);
+    graphLogic->createEdge(EdgeData(), base, child);
+
+    graphLogic->beginDrag(base, true);
+    QCOMPARE(graphLogic->m_dragNodes.size(), 2);
+    for (int i = 0; i < 50; i++)
+        graphLogic->drag(1, -0.5);
+    graphLogic->endDrag();
+
+    QCOMPARE(stack.count(), 1);
+    QCOMPARE(child->pos(), QPointF(150, -25));
+    QCOMPARE(base->pos(), QPointF(50, -25));
+
+    stack.undo();
+    QCOMPARE(child->pos(), QPointF(100, 0));
+    QCOMPARE(base->pos(), QPointF(0, 0));
+
+    stack.redo();
+    QCOMPARE(child->pos(), QPointF(150, -25));
+
+    // the next drag is a step of its own
+    graphLogic->beginDrag(base, false);
+    graphLogic->drag(-10, 0);
+    graphLogic->endDrag();
+    QCOMPARE(stack.count(), 2);
+    QCOMPARE(base->pos(), QPointF(40, -25));
+    QCOMPARE(child->pos(), QPointF(150, -25));
+
+    // a click without moving is not a step
+    graphLogic->beginDrag(base, false);
+    graphLogic->endDrag();
+    QCOMPARE(stack.count(), 2);
+
+    graphLogic->setUndoStack(0);
+    stack.clear();
+    graphLogic->removeAllNodes();
+    delete mainWindow;
+}
+
+/** The moves of a Node in one event loop turn adjust its edges once
+  */
+void AlgorithmTests::adjustCoalescing()
+{
+    MainWindow *mainWindow = new MainWindow;
+    GraphWidget *graphWidget = new GraphWidget(mainWindow);
+    GraphLogic *graphLogic = graphWidget->graphLogic();
+
+    graphLogic->addFirstNode();
+    Node *base = graphLogic->m_activeNode;
+    NodeData data;
+    data.m_id = 1;
+    data.m_x = 100;
+    Node *child = graphLogic->createNode(data);
+    Edge *edge = graphLogic->createEdge(EdgeData(), base, child);
+    graphLogic->flushAdjusts();
+
+    const quint64 requests = graphLogic->adjustRequests();
+    const quint64 runs = graphLogic->adjustRuns();
+    const QPointF before = edge->m_destPoint;
+
+    child->setPos(150, 0);
+    child->setPos(200, 0);
+    child->setPos(250, 0);
+    QCOMPARE(graphLogic->adjustRequests() - requests, quint64(3));
+    QCOMPARE(graphLogic->adjustRuns() - runs, quint64(0));
+    QVERIFY(edge->adjustPending());
+    QCOMPARE(edge->m_destPoint, before);
+
+    // the event loop flushes it
+    QTest::qWait(10);
+    QVERIFY(!edge->adjustPending());
+    QCOMPARE(graphLogic->adjustRuns() - runs, quint64(1));
+    QVERIFY(edge->m_destPoint.x() > before.x() + 100);
+
+    // a deleted edge leaves the queue
+    child->setPos(300, 0);
+    delete edge;
+    graphLogic->flushAdjusts();
+    QCOMPARE(graphLogic->adjustRuns() - runs, quint64(1));
+
+    graphLogic->removeAllNodes();
+    delete mainWindow;
+}
+
+// a BSP tree for big maps, none for small ones and during bulk changes
+void AlgorithmTests::itemIndexPolicy()
+{
+    MainWindow *mainWindow = new MainWindow;
+    GraphWidget *graphWidget = new GraphWidget(mainWindow);
+    GraphLogic *graphLogic = graphWidget->graphLogic();
+    QGraphicsScene *scene = graphWidget->scene();
+
+    graphLogic->addFirstNode();
+    QCOMPARE(scene->itemIndexMethod(), QGraphicsScene::NoIndex);
+
+    // a Node and an Edge per step
+    Node *base = graphLogic->m_activeNode;
+    for (int i = 1; i < GraphLogic::m_bspIndexItems / 2; i++)
+    {
+        NodeData data;
+        data.m_id = i;
+        data.m_x = i % 100 * 50;
+        data.m_y = i / 100 * 50;
+        graphLogic->createEdge(EdgeData(), base,
+                               graphLogic->createNode(data));
+    }
+    QCOMPARE(scene->itemIndexMethod(), QGraphicsScene::NoIndex);
+
+    NodeData data;
+    data.m_id = GraphLogic::m_bspIndexItems;
+    Node *last = graphLogic->createNode(data);
+    QCOMPARE(scene->itemIndexMethod(), QGraphicsScene::BspTreeIndex);
+
+    // no switch back at the limit
+    graphLogic->m_nodeList.removeOne(last);
+    delete last;
+    QCOMPARE(scene->itemIndexMethod(), QGraphicsScene::BspTreeIndex);
+
+    // the subtree of the base is dragged without an index
+    graphLogic->m_activeNode = base;
+    graphLogic->beginDrag(base, true);
+    QCOMPARE(scene->itemIndexMethod(), QGraphicsScene::NoIndex);
+    graphLogic->drag(10, 0);
+    graphLogic->endDrag();
+    QCOMPARE(scene->itemIndexMethod(), QGraphicsScene::BspTreeIndex);
+
+    // a single Node is dragged with it
+    graphLogic->beginDrag(base, false);
+    QCOMPARE(scene->itemIndexMethod(), QGraphicsScene::BspTreeIndex);
+    graphLogic->endDrag();
+
+    graphLogic->removeAllNodes();
+    QCOMPARE(scene->itemIndexMethod(), QGraphicsScene::NoIndex);
+
+    delete mainWindow;
+}
+
+/** Nodes are placed, inserted, moved and scaled anywhere, the canvas
+  * follows them in a few steps
+  */
+void AlgorithmTests::farFromOrigin()
+{
+    MainWindow *mainWindow = new MainWindow;
+    GraphWidget *graphWidget = new GraphWidget(mainWindow);
+    GraphLogic *graphLogic = graphWidget->graphLogic();
+    QUndoStack stack;
+    graphLogic->setUndoStack(&stack);
+    QSignalSpy resizes(graphWidget->scene(), SIGNAL(sceneRectChanged(QRectF)));
+
+    graphLogic->addFirstNode();
+
+    // a line of Nodes from the base to a million pixels away
+    const int count = 5000;
+    for (int i = 1; i <= count; i++)
+    {
+        const QPointF pos(i * 200.0, -i * 150.0);
+        Node *node = textNode(graphLogic, pos, 1);
+        QCOMPARE(node->pos(), pos);
+    }
+
+    QRectF content;
+    foreach(Node *node, graphLogic->m_nodeList)
+        content |= node->sceneBoundingRect();
+
+    // the Nodes are created at the origin and moved out after it
+    QVERIFY(graphLogic->contentRect().contains(content));
+    QCOMPARE(graphLogic->contentRect().right(), content.right());
+    QCOMPARE(graphLogic->contentRect().top(), content.top());
+    QVERIFY(graphWidget->sceneRect().contains(content));
+    QVERIFY(resizes.count() < 50);
+
+    // a new Node next to the last one, then moved and scaled further out
+    Node *last = graphLogic->m_nodeList.last();
+    graphLogic->setActiveNode(last);
+    graphLogic->insertNode();
+    QCOMPARE(graphLogic->m_nodeList.size(), count + 2);
+    Node *inserted = graphLogic->m_nodeList.last();
+    QVERIFY(QLineF(inserted->pos(), last->pos()).length() < 200);
+
+    inserted->setPos(-2e6, 3e6);
+    QCOMPARE(inserted->pos(), QPointF(-2e6, 3e6));
+    inserted->setScale(4);
+    QCOMPARE(inserted->scale(), qreal(5));
+    QVERIFY(graphWidget->sceneRect().contains(
+                inserted->sceneBoundingRect()));
+
+    // the export is cut to the Nodes, the canvas keeps its old size
+    inserted->setPos(last->pos() + QPointF(200, 0));
+    QRectF bounds;
+    foreach(Node *node, graphLogic->m_nodeList)
+        bounds |= node->sceneBoundingRect();
+
+    const int margin = GraphLogic::m_exportMargin;
+    QCOMPARE(graphLogic->exportRect(),
+             bounds.adjusted(-margin, -margin, margin, margin));
+    QVERIFY(!graphLogic->exportRect().contains(QPointF(-2e6, 3e6)));
+    QVERIFY(graphWidget->sceneRect().contains(QPointF(-2e6, 3e6)));
+
+    // a new map starts on the default canvas
+    graphLogic->removeAllNodes();
+    QCOMPARE(graphWidget->sceneRect(), GraphWidget::m_defaultCanvas);
+    QVERIFY(graphLogic->contentRect().isNull());
+
+    delete mainWindow;
+}
+
+// the scene around rect drawn at zoom
+static QImage renderScene(QGraphicsScene *scene, const QRectF &rect,
+                          const qreal &zoom)
+{
+    QImage image(qCeil(rect.width() * zoom), qCeil(rect.height() * zoom),
+                 QImage::Format_ARGB32_Premultiplied);
+    image.fill(0xffffffff);
+
+    QPainter painter(&image);
+    scene->render(&painter, QRectF(QPointF(), rect.size() * zoom), rect);
+    painter.end();
+
+    return image;
+}
+
+// a box, bars in place of the lines and the text, by the zoom
+void AlgorithmTests::levelOfDetail()
+{
+    MainWindow *mainWindow = new MainWindow;
+    GraphWidget *graphWidget = new GraphWidget(mainWindow);
+    GraphLogic *graphLogic = graphWidget->graphLogic();
+
+    graphLogic->addFirstNode();
+    Node *node = textNode(graphLogic, QPointF(1000, 1000), 1);
+    const QRectF rect = node->sceneBoundingRect();
+
+    QImage image = renderScene(graphWidget->scene(), rect, 0.1);
+    QVERIFY(!node->m_greekedLinesValid);
+    QCOMPARE(QColor(image.pixel(image.width() / 2, image.height() / 2)),
+             node->color());
+
+    renderScene(graphWidget->scene(), rect, 0.4);
+    QVERIFY(node->m_greekedLinesValid);
+    QCOMPARE(node->m_greekedLines.size(), 2);
+    foreach(const QRectF &line, node->m_greekedLines)
+        QVERIFY(node->boundingRect().contains(line));
+
+    renderScene(graphWidget->scene(), rect, 1);
+
+    // the bars follow the text
+    node->setContent(NodeData::PlainText, "one line");
+    QVERIFY(!node->m_greekedLinesValid);
+    renderScene(graphWidget->scene(), rect, 0.4);
+    QCOMPARE(node->m_greekedLines.size(), 1);
+
+    // a small Node has its text in an image exported at a high resolution
+    Node *small = textNode(graphLogic, QPointF(-1000, 1000), 0.4);
+    SceneSnapshot sharp(graphWidget->scene(), 4);
+    QVERIFY(!small->m_greekedLinesValid);
+    SceneSnapshot screen(graphWidget->scene(), 1);
+    QVERIFY(small->m_greekedLinesValid);
+
+    graphLogic->removeAllNodes();
+    delete mainWindow;
+}
+
+// the line of the Edge is drawn once, by the layer if it is on
+static bool lineDrawn(QGraphicsScene *scene, Edge *edge)
+{
+    const QPointF middle = edge->line().pointAt(0.5);
+    const QImage image = renderScene(scene,
+                                     QRectF(middle - QPointF(5, 5),
+                                            QSizeF(10, 10)), 1);
+
+    // it is on the border of two pixel rows or columns
+    for (int x = 4; x <= 5; x++)
+        for (int y = 4; y <= 5; y++)
+            if (QColor(image.pixel(x, y)) == edge->color())
+                return true;
+
+    return false;
+}
+
+// the grid of the layer follows the Edges
+void AlgorithmTests::edgeLayer()
+{
+    MainWindow *mainWindow = new MainWindow;
+    GraphWidget *graphWidget = new GraphWidget(mainWindow);
+    GraphLogic *graphLogic = graphWidget->graphLogic();
+    QGraphicsScene *scene = graphWidget->scene();
+
+    graphLogic->addFirstNode();
+    Node *base = graphLogic->m_activeNode;
+    Node *near = textNode(graphLogic, base->pos() + QPointF(300, 0), 1);
+    Node *far = textNode(graphLogic, QPointF(5000, 5000), 1);
+    Node *farther = textNode(graphLogic, QPointF(5300, 5000), 1);
+    Edge *nearEdge = graphLogic->createEdge(EdgeData(), base, near);
+    Edge *farEdge = graphLogic->createEdge(EdgeData(), far, farther);
+    nearEdge->setColor(Qt::red);
+    graphLogic->flushAdjusts();
+    QVERIFY(lineDrawn(scene, nearEdge));
+
+    graphLogic->setEdgeLayer();
+    EdgeLayer *layer = graphLogic->edgeLayer();
+    QVERIFY(layer);
+    QCOMPARE(layer->edgeCount(), 2);
+    QVERIFY(nearEdge->flags() & QGraphicsItem::ItemHasNoContents);
+    QVERIFY(lineDrawn(scene, nearEdge));
+
+    const QRectF nearRect = nearEdge->boundingRect();
+    QCOMPARE(layer->edgesIn(nearRect), QList<Edge *>() << nearEdge);
+    QCOMPARE(layer->edgesIn(farEdge->boundingRect()),
+             QList<Edge *>() << farEdge);
+
+    // moved to an other cell, the old end is empty
+    near->setPos(base->pos() + QPointF(0, 1000));
+    graphLogic->flushAdjusts();
+    QVERIFY(layer->edgesIn(QRectF(nearRect.right() - 10, nearRect.top(),
+                                  10, nearRect.height())).isEmpty());
+    QVERIFY(layer->edgesIn(nearEdge->boundingRect()).contains(nearEdge));
+    QVERIFY(lineDrawn(scene, nearEdge));
+
+    // a long Edge does not fill the cells under its rect
+    Edge *longEdge = graphLogic->createEdge(EdgeData(), base, far);
+    graphLogic->flushAdjusts();
+    QVERIFY(layer->m_oversizedEdges.contains(longEdge));
+    QVERIFY(!layer->m_cells.contains(EdgeLayer::cellKey(10, 10)));
+    QVERIFY(layer->edgesIn(QRectF(2500, 2500, 10, 10)).contains(longEdge));
+    delete longEdge;
+    QVERIFY(layer->m_oversizedEdges.isEmpty());
+
+    // removed and added back by the undo commands
+    scene->removeItem(farEdge);
+    QVERIFY(!layer->contains(farEdge));
+    scene->addItem(farEdge);
+    QVERIFY(layer->contains(farEdge));
+
+    graphLogic->setEdgeLayer(false);
+    QVERIFY(!graphLogic->edgeLayer());
+    QVERIFY(!(nearEdge->flags() & QGraphicsItem::ItemHasNoContents));
+    QVERIFY(lineDrawn(scene, nearEdge));
+
+    // a big map switches it on by itself
+    Node *previous = base;
+    for (int i = graphLogic->m_sceneEdgeCount;
+         i < GraphLogic::m_edgeLayerEdges; i++)
+    {
+        QVERIFY(!graphLogic->edgeLayer());
+        NodeData data;
+        data.m_id = graphLogic->m_nextNodeId;
+        data.m_x = i * 10;
+        Node *node = graphLogic->createNode(data);
+        graphLogic->createEdge(EdgeData(), previous, node);
+        previous = node;
+    }
+
+    QVERIFY(graphLogic->edgeLayer());
+    QCOMPARE(graphLogic->edgeLayer()->edgeCount(),
+             GraphLogic::m_edgeLayerEdges);
+    QVERIFY(nearEdge->flags() & QGraphicsItem::ItemHasNoContents);
+
+    graphLogic->removeAllNodes();
+    delete mainWindow;
+}
+
+// one shadow item under the active Node, the Nodes have no effects
+void AlgorithmTests::nodeShadow()
+{
+    MainWindow *mainWindow = new MainWindow;
+    GraphWidget *graphWidget = new GraphWidget(mainWindow);
+    GraphLogic *graphLogic = graphWidget->graphLogic();
+
+    graphLogic->addFirstNode();
+    Node *base = graphLogic->m_activeNode;
+    Node *other = textNode(graphLogic, QPointF(200, 0), 1);
+    QVERIFY(!base->graphicsEffect());
+    QVERIFY(!other->graphicsEffect());
+
+    NodeShadow *shadow = graphLogic->nodeShadow();
+    QVERIFY(shadow);
+    QCOMPARE(shadow->node(), base);
+    QVERIFY(shadow->isVisible());
+    QCOMPARE(shadow->scene(), graphWidget->scene());
+    QCOMPARE(shadow->pos(), base->pos() + NodeShadow::m_offset);
+
+    graphLogic->setActiveNode(other);
+    QCOMPARE(shadow->node(), other);
+    QCOMPARE(graphLogic->nodeShadow(), shadow);
+
+    // it takes the moves, the scaling and the size of the text
+    other->setPos(300, 100);
+    QCOMPARE(shadow->pos(), QPointF(300, 100) + NodeShadow::m_offset);
+    other->setScale(1);
+    QCOMPARE(shadow->scale(), qreal(2));
+    other->setContent(NodeData::PlainText,
+                      "a much longer line than the one before");
+    QCOMPARE(shadow->boundingRect(), other->boundingRect());
+
+    // the Node leaves the scene, by a remove command for example
+    graphWidget->scene()->removeItem(other);
+    QVERIFY(!shadow->isVisible());
+    graphWidget->scene()->addItem(other);
+
+    graphLogic->setActiveNode(base);
+    QCOMPARE(shadow->node(), base);
+
+    graphLogic->removeAllNodes();
+    QVERIFY(!shadow->isVisible());
+    delete mainWindow;
+}
+
+/** The closed form leaves shape() where the walk does, in every direction
+  * and at every scale
+  */
+void AlgorithmTests::intersection()
+{
+    MainWindow *mainWindow = new MainWindow;
+    GraphWidget *graphWidget = new GraphWidget(mainWindow);
+    GraphLogic *graphLogic = graphWidget->graphLogic();
+
+    const qreal step = 0.0001;
+    const qreal length = 300;
+    QList<qreal> scales;
+    scales << 1 << 0.5 << 2.5;
+    foreach(qreal scale, scales)
+    {
+        Node *node = textNode(graphLogic, QPointF(-50, -20), scale);
+        QPainterPath path(node->mapToScene(node->shape()));
+        const QPointF center(node->sceneBoundingRect().center());
+
+        for (int i = 0; i < 72; i++)
+        {
+            const qreal angle = i * Pi / 36 + 0.01;
+            const QLineF line(center + QPointF(::cos(angle), ::sin(angle)) *
+                                  length,
+                              center);
+
+            const QPointF exact(node->intersection(line, true));
+            const QPointF walked(bruteForceIntersection(path, line, true,
+                                                        step));
+
+            // the walk is off by a step at most, QPainterPath approximates
+            // the corners with bezier curves
+            QVERIFY(QLineF(exact, walked).length() < step * length + 0.1);
+            QVERIFY(QLineF(node->intersection(QLineF(center, line.p1())),
+                           exact).length() < 1e-6);
+        }
+    }
+
+    graphLogic->removeAllNodes();
+    delete mainWindow;
+}
+
+/** adjust() prepares everything, the angle is there without a paint()
+  */
+void AlgorithmTests::edgeGeometry()
+{
+    MainWindow *mainWindow = new MainWindow;
+    GraphWidget *graphWidget = new GraphWidget(mainWindow);
+    GraphLogic *graphLogic = graphWidget->graphLogic();
+
+    Node *source = textNode(graphLogic, QPointF(0, 0), 1);
+    Node *destination = textNode(graphLogic, QPointF(200, 0), 1);
+    Edge *edge = graphLogic->createEdge(EdgeData(), source, destination);
+    graphLogic->flushAdjusts();
+
+    // pointing right, the arrow is at the destination
+    QCOMPARE(edge->angle(), 2 * Pi);
+    QVERIFY(!edge->m_overlap);
+    QCOMPARE(edge->m_arrow.size(), 3);
+    QCOMPARE(edge->m_arrow.first(), edge->m_destPoint);
+    QVERIFY(edge->boundingRect().contains(edge->m_sourcePoint));
+    QVERIFY(edge->boundingRect().contains(edge->m_arrow.boundingRect()));
+
+    // the new nodes of the source go to the left
+    QCOMPARE(source->calculateBiggestAngle(), - Pi);
+
+    // a wider edge has a bigger arrow and bounding rect
+    const QRectF narrow = edge->boundingRect();
+    edge->setWidth(5);
+    QVERIFY(edge->boundingRect().contains(narrow));
+    QVERIFY(edge->boundingRect() != narrow);
+
+    // on top of each other nothing is drawn
+    destination->setPos(10, 5);
+    graphLogic->flushAdjusts();
+    QVERIFY(edge->m_overlap);
+
+    graphLogic->removeAllNodes();
+    delete mainWindow;
+}
+
+// what every Edge::adjust() does once
+void AlgorithmTests::intersectionAnalyticBenchmark()
+{
+    MainWindow *mainWindow = new MainWindow;
+    GraphWidget *graphWidget = new GraphWidget(mainWindow);
+    GraphLogic *graphLogic = graphWidget->graphLogic();
+    Node *node = textNode(graphLogic, QPointF(0, 0), 1);
+    const QPointF center(node->sceneBoundingRect().center());
+
+    QPointF sum;
+    QBENCHMARK
+    {
+        for (int i = 0; i < 360; i++)
+        {
+            const qreal angle = i * Pi / 180;
+            sum += node->intersection(
+                        QLineF(center + QPointF(::cos(angle), ::sin(angle)) *
+                                   200,
+                               center),
+                        true);
+        }
+    }
+
+    QVERIFY(!sum.isNull());
+    graphLogic->removeAllNodes();
+    delete mainWindow;
+}
+
+// the old way: a path of the scene rect and 100 contains() calls at most
+void AlgorithmTests::intersectionBruteForceBenchmark()
+{
+    MainWindow *mainWindow = new MainWindow;
+    GraphWidget *graphWidget = new GraphWidget(mainWindow);
+    GraphLogic *graphLogic = graphWidget->graphLogic();
+    Node *node = textNode(graphLogic, QPointF(0, 0), 1);
+    const QPointF center(node->sceneBoundingRect().center());
+
+    QPointF sum;
+    QBENCHMARK
+    {
+        for (int i = 0; i < 360; i++)
+        {
+            const qreal angle = i * Pi / 180;
+            QPainterPath path;
+            path.addRoundedRect(node->sceneBoundingRect(), 28.0, 28.0);
+            sum += bruteForceIntersection(
+                        path,
+                        QLineF(center + QPointF(::cos(angle), ::sin(angle)) *
+                                   200,
+                               center),
+                        true);
+        }
+    }
+
+    QVERIFY(!sum.isNull());
+    graphLogic->removeAllNodes();
+    delete mainWindow;
+}
+
+/** The scene items write their changes into the model of their GraphLogic
+  */
+void AlgorithmTests::snapshotFollowsScene()
+{
+    MainWindow *mainWindow = new MainWindow;
+    GraphWidget *graphWidget = new GraphWidget(mainWindow);
+    GraphLogic *graphLogic = graphWidget->graphLogic();
+
+    graphLogic->addFirstNode();
+    Node *base = graphLogic->m_activeNode;
+    base->setPos(30, 40);
+    base->setColor(QColor(255, 0, 0));
+
+    QList<Node *> children;
+    for (int i = 0; i < 3; i++)
+    {
+        NodeData data;
+        data.m_id = 7 + i;
+        data.m_x = -50 * i;
+        data.m_contentType = NodeData::PlainText;
+        data.m_content = QString("child %1").arg(i);
+        children << graphLogic->createNode(data);
+        graphLogic->createEdge(EdgeData(), base, children.last());
+    }
+
+    base->edgeTo(children[2])->setWidth(3);
+
+    MapData map = graphLogic->snapshot();
+    QCOMPARE(map.m_nodes.size(), 4);
+    QCOMPARE(map.m_edges.size(), 3);
+    QCOMPARE(map.m_nodes[0].m_x, qreal(30));
+    QCOMPARE(map.m_nodes[0].m_y, qreal(40));
+    QCOMPARE(map.m_nodes[0].m_color, QColor(255, 0, 0).rgb());
+    QVERIFY(!map.m_nodes[0].m_content.isEmpty());
+    QCOMPARE(map.m_nodes[1].m_content, QString("child 0"));
+    QCOMPARE(map.m_edges[2].m_width, qreal(3));
+
+    // a removal does not reorder the saved nodes
+    Node *removed = children[0];
+    delete base->edgeTo(removed);
+    graphWidget->scene()->removeItem(removed);
+    graphLogic->m_nodeList.removeAll(removed);
+    delete removed;
+
+    map = graphLogic->snapshot();
+    QCOMPARE(map.m_nodes.size(), 3);
+    QCOMPARE(map.m_nodes[1].m_id, 8);
+    QCOMPARE(map.m_nodes[2].m_id, 9);
+    QCOMPARE(graphLogic->m_sceneNodeCount, 3);
+    QCOMPARE(graphLogic->m_sceneEdgeCount, 2);
+
+    delete mainWindow;
+}
+
+void AlgorithmTests::journalOnReadMap()
+{
+    MapData map;
+    for (int i = 0; i < 3; i++)
+    {
+        NodeData node;
+        node.m_id = i;
+        node.m_x = i * 100;
+        map.m_nodes.append(node);
+    }
+
+    for (int i = 1; i < 3; i++)
+    {
+        EdgeData edge;
+        edge.m_source = 0;
+        edge.m_destination = i;
+        map.m_edges.append(edge);
+    }
+
+    const QString fileName = QDir::tempPath() + "/qtmindmap_journaltest.qmm";
+    QVERIFY(MapWriter::write(fileName, map).isEmpty());
+
+    // a node inserted under 1, node 2 removed, 1 moved, recolored and
+    // scaled past the widest edge
+    QByteArray batch;
+    QDataStream stream(&batch, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_6);
+    stream << quint8(Journal::InsertNodeRecord) << qint32(5) << qint32(1)
+           << double(10) << double(20) << quint32(0xffff0000u)
+           << quint32(0xff000000u) << double(2);
+    stream << quint8(Journal::RemoveNodesRecord)
+           << (QList<qint32>() << 2);
+    stream << quint8(Journal::MoveRecord) << (QList<qint32>() << 1)
+           << double(5) << double(-5);
+    stream << quint8(Journal::NodeColorRecord) << (QList<qint32>() << 1)
+           << quint32(0xff00ff00u);
+    stream << quint8(Journal::ScaleRecord) << (QList<qint32>() << 1)
+           << double(200);
+
+    Journal journal(fileName);
+    QVERIFY(journal.append(batch));
+    MapData replayed = map;
+    QVERIFY(GraphLogic::replayJournal(journal, &replayed));
+
+    // the nodes of the file keep their order, the inserted one is last
+    QCOMPARE(replayed.m_nodes.size(), 3);
+    QCOMPARE(replayed.m_edges.size(), 2);
+    QCOMPARE(replayed.m_nodes[0].m_id, 0);
+    QCOMPARE(replayed.m_nodes[1].m_id, 1);
+    QCOMPARE(replayed.m_nodes[2].m_id, 5);
+    QCOMPARE(replayed.m_nodes[1].m_x, qreal(105));
+    QCOMPARE(replayed.m_nodes[1].m_y, qreal(-5));
+    QCOMPARE(replayed.m_nodes[1].m_scale, qreal(201));
+    QCOMPARE(replayed.m_nodes[2].m_x, qreal(10));
+    foreach(const EdgeData &edge, replayed.m_edges)
+    {
+        QVERIFY(edge.m_destination != 2);
+        if (edge.m_destination == 1)
+        {
+            QCOMPARE(edge.m_color, quint32(0xff00ff00u));
+            QCOMPARE(edge.m_width, qreal(1));
+        }
+        if (edge.m_destination == 5)
+            QCOMPARE(edge.m_width, qreal(2));
+    }
+
+    // a broken record stops the replay, the ones before it are kept
+    QByteArray broken;
+    QDataStream brokenStream(&broken, QIODevice::WriteOnly);
+    brokenStream.setVersion(QDataStream::Qt_4_6);
+    brokenStream << quint8(Journal::MoveRecord) << (QList<qint32>() << 0)
+                 << double(1) << double(1);
+    brokenStream << quint8(Journal::InsertNodeRecord) << qint32(6)
+                 << qint32(2) << double(0) << double(0) << quint32(0)
+                 << quint32(0) << double(1);
+    QVERIFY(journal.append(broken));
+    MapData partly = map;
+    QVERIFY(!GraphLogic::replayJournal(journal, &partly));
+    QCOMPARE(partly.m_nodes.size(), 3);
+    QCOMPARE(partly.m_nodes[0].m_x, qreal(1));
+
+    QFile::remove(journal.fileName());
+    QFile::remove(fileName);
+}
+
 
 QTEST_MAIN(AlgorithmTests)
@@ -12,6 +12,22 @@ public:
 
 private slots:
     void calculateBiggestAngle();
+    void compactContent();
+    void adjacency();
+    void subtreeIndex();
+    void dragGesture();
+    void adjustCoalescing();
+    void itemIndexPolicy();
+    void farFromOrigin();
+    void levelOfDetail();
+    void edgeLayer();
+    void nodeShadow();
+    void intersection();
+    void edgeGeometry();
+    void intersectionAnalyticBenchmark();
+    void intersectionBruteForceBenchmark();
+    void snapshotFollowsScene();
+    void journalOnReadMap();
 
 };
 
@@ -0,0 +1,106 @@
+#include "corebenchmarks.h"
+
+#include "include/mapreader.h"
+#include "include/mapwriter.h"
+#include "include/layoutmath.h"
+
+static const int NodeCount = 20000;
+
+CoreBenchmarks::CoreBenchmarks(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void CoreBenchmarks::initTestCase()
+{
+    m_fileName = QDir::tempPath() + "/qtmindmap_corebenchmark.qmm";
+    m_binaryFileName = QDir::tempPath() + "/qtmindmap_corebenchmark.qmmb";
+
+    // the same tree as in FileBenchmarks, without the scene
+    qsrand(42);
+    m_map.m_nodes.reserve(NodeCount);
+    for (int i = 0; i < NodeCount; i++)
+    {
+        NodeData node;
+        node.m_id = i;
+        node.m_x = qrand() % 700 - 350;
+        node.m_y = qrand() % 700 - 350;
+        node.m_color = mapColor(255, 215, 0);
+        node.m_contentType = NodeData::PlainText;
+        node.m_content = QString("node %1").arg(i);
+        m_map.m_nodes.append(node);
+
+        if (i == 0)
+            continue;
+
+        EdgeData edge;
+        edge.m_source = (i - 1) / 4;
+        edge.m_destination = i;
+        m_map.m_edges.append(edge);
+    }
+}
+
+void CoreBenchmarks::cleanupTestCase()
+{
+    QFile::remove(m_fileName);
+    QFile::remove(m_binaryFileName);
+}
+
+void CoreBenchmarks::writeXml()
+{
+    QBENCHMARK
+    {
+        QVERIFY(MapWriter::write(m_fileName, m_map).isEmpty());
+    }
+}
+
+void CoreBenchmarks::writeBinary()
+{
+    QBENCHMARK
+    {
+        QVERIFY(MapWriter::write(m_binaryFileName, m_map).isEmpty());
+    }
+}
+
+void CoreBenchmarks::readXml()
+{
+    QVERIFY(MapWriter::write(m_fileName, m_map).isEmpty());
+
+    QBENCHMARK
+    {
+        MapData map;
+        QVERIFY(MapReader::read(m_fileName, &map).isEmpty());
+        QCOMPARE(map.m_nodes.size(), NodeCount);
+    }
+}
+
+void CoreBenchmarks::readBinary()
+{
+    QVERIFY(MapWriter::write(m_binaryFileName, m_map).isEmpty());
+
+    QBENCHMARK
+    {
+        MapData map;
+        QVERIFY(MapReader::read(m_binaryFileName, &map).isEmpty());
+        QCOMPARE(map.m_nodes.size(), NodeCount);
+    }
+}
+
+// a node with five edges, for every node of the map
+void CoreBenchmarks::biggestGapAngle()
+{
+    QList<double> angles;
+    angles << 0.3 << 1.2 << 2.0 << 4.1 << 5.5;
+
+    double sum = 0;
+    QBENCHMARK
+    {
+        for (int i = 0; i < NodeCount; i++)
+            sum += LayoutMath::biggestGapAngle(angles);
+    }
+
+    QVERIFY(sum > 0);
+}
+
+
+QTEST_MAIN(CoreBenchmarks)
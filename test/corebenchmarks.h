@@ -0,0 +1,34 @@
+#ifndef COREBENCHMARKS_H
+#define COREBENCHMARKS_H
+
+#include <QtTest/QtTest>
+
+#include "include/mapdata.h"
+
+/** Benchmarks of the core library, they run under QCoreApplication:
+  * no display and no scene items are needed.
+  */
+class CoreBenchmarks : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CoreBenchmarks(QObject *parent = 0);
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void writeXml();
+    void writeBinary();
+    void readXml();
+    void readBinary();
+    void biggestGapAngle();
+
+private:
+    MapData m_map;
+    QString m_fileName;
+    QString m_binaryFileName;
+};
+
+#endif // COREBENCHMARKS_H
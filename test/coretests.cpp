@@ -0,0 +1,99 @@
+#include "coretests.h"
+
+#include <math.h>
+
+#include "include/layoutmath.h"
+
+using LayoutMath::pi;
+
+CoreTests::CoreTests(QObject *parent)
+    : QObject(parent)
+{
+}
+
+// the remainder keeps the sign of the divided, as fmod() does
+void CoreTests::modulo()
+{
+    QCOMPARE(LayoutMath::modulo(5.5, 2), 1.5);
+    QCOMPARE(LayoutMath::modulo(2.5 * pi, 2 * pi), 0.5 * pi);
+    QCOMPARE(LayoutMath::modulo(-1, 2 * pi), -1.0);
+}
+
+/** The directions of the edges of a Node, what
+  * Node::calculateBiggestAngle() gives to the layout math
+  */
+void CoreTests::biggestGapAngle()
+{
+    // edges to the right, to the left and up
+    QList<double> angles;
+    angles << 2 * pi << pi << 0.5 * pi;
+    QCOMPARE(LayoutMath::biggestGapAngle(angles), 0.5 * pi);
+
+    // the gap is the whole circle but the one direction
+    QCOMPARE(LayoutMath::biggestGapAngle(QList<double>() << 0.25 * pi),
+             0.75 * pi);
+
+    // the biggest gap goes through 0
+    angles.clear();
+    angles << 0.5 * pi << 0.75 * pi;
+    QCOMPARE(LayoutMath::biggestGapAngle(angles), 0.375 * pi);
+
+    // the order of the edges does not matter
+    angles.clear();
+    angles << pi << 0 << 0.5 * pi;
+    QCOMPARE(LayoutMath::biggestGapAngle(angles), 0.5 * pi);
+}
+
+void CoreTests::roundedRectContains()
+{
+    const QRectF rect(0, 0, 100, 40);
+    QVERIFY(LayoutMath::roundedRectContains(rect, 20, 15, QPointF(50, 20)));
+    QVERIFY(LayoutMath::roundedRectContains(rect, 20, 15, QPointF(50, 0)));
+    QVERIFY(LayoutMath::roundedRectContains(rect, 20, 15, QPointF(0, 20)));
+    QVERIFY(!LayoutMath::roundedRectContains(rect, 20, 15, QPointF(1, 1)));
+    QVERIFY(!LayoutMath::roundedRectContains(rect, 20, 15,
+                                             QPointF(101, 20)));
+
+    // no radius, the corners are in
+    QVERIFY(LayoutMath::roundedRectContains(rect, 0, 0, QPointF(0, 0)));
+}
+
+/** The exit is on the border in every direction: just before it the ray
+  * is inside, just after it outside
+  */
+void CoreTests::roundedRectExit()
+{
+    const QRectF rect(0, 0, 100, 40);
+    const QPointF center(rect.center());
+    for (int i = 0; i < 72; i++)
+    {
+        const double angle = i * pi / 36 + 0.01;
+        const QPointF direction(::cos(angle), ::sin(angle));
+        const QPointF border(LayoutMath::roundedRectExit(rect, 20, 15,
+                                                         center, direction));
+
+        QVERIFY(LayoutMath::roundedRectContains(rect, 20, 15,
+                                                border - direction * 0.01));
+        QVERIFY(!LayoutMath::roundedRectContains(rect, 20, 15,
+                                                 border + direction * 0.01));
+    }
+
+    // from outside there is nothing to leave
+    QCOMPARE(LayoutMath::roundedRectExit(rect, 20, 15, QPointF(-10, 20),
+                                         QPointF(1, 0)),
+             QPointF(-10, 20));
+    QCOMPARE(LayoutMath::roundedRectExit(rect, 20, 15, QPointF(50, 20),
+                                         QPointF()),
+             QPointF(50, 20));
+
+    // the straight part of the sides, and a radius clamped to the side
+    QCOMPARE(LayoutMath::roundedRectExit(rect, 20, 15, QPointF(50, 20),
+                                         QPointF(1, 0)),
+             QPointF(100, 20));
+    QCOMPARE(LayoutMath::roundedRectExit(rect, 20, 30, QPointF(50, 20),
+                                         QPointF(0, -1)),
+             QPointF(50, 0));
+}
+
+
+QTEST_MAIN(CoreTests)
@@ -0,0 +1,24 @@
+#ifndef CORETESTS_H
+#define CORETESTS_H
+
+#include <QtTest/QtTest>
+
+/** Tests of the core library, they run under QCoreApplication:
+  * the layout math needs no window and no scene.
+  */
+class CoreTests : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CoreTests(QObject *parent = 0);
+
+private slots:
+    void modulo();
+    void biggestGapAngle();
+    void roundedRectContains();
+    void roundedRectExit();
+
+};
+
+#endif // CORETESTS_H
@@ -0,0 +1,644 @@
+#define private public
+
+#include "filebenchmarks.h"
+
+#include <QDebug>
+#include <QtXml>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QGraphicsDropShadowEffect>
+
+#include "include/mainwindow.h"
+#include "include/graphwidget.h"
+#include "include/graphlogic.h"
+#include "include/node.h"
+#include "include/edge.h"
+#include "include/mapwriter.h"
+
+#include <math.h>
+
+static const int NodeCount = 20000;
+static const int SubtreeSize = 10000;
+static const int ShadowNodeCount = 50000;
+
+/** The saving path before the streaming writer: build a QDomDocument,
+  * turn it into one QString and write that through a QTextStream.
+  * Kept here as the baseline of the comparison.
+  */
+static void writeWithDom(const QList<Node *> &nodeList,
+                         const QString &fileName)
+{
+    QDomDocument doc("QtMindMap");
+
+    QDomElement root = doc.createElement("qtmindmap");
+    doc.appendChild( root );
+
+    QDomElement nodes_root = doc.createElement("nodes");
+    root.appendChild(nodes_root);
+    foreach(Node *node, nodeList)
+    {
+        QDomElement cn = doc.createElement("node");
+        cn.setAttribute( "x", QString::number(node->pos().x()));
+        cn.setAttribute( "y", QString::number(node->pos().y()));
+        cn.setAttribute( "htmlContent", node->toHtml());
+        cn.setAttribute( "scale", QString::number(node->scale()));
+        cn.setAttribute( "bg_red", QString::number(node->color().red()));
+        cn.setAttribute( "bg_green", QString::number(node->color().green()));
+        cn.setAttribute( "bg_blue", QString::number(node->color().blue()));
+        cn.setAttribute( "text_red", QString::number(node->textColor().red()));
+        cn.setAttribute( "text_green",
+                        QString::number(node->textColor().green()));
+        cn.setAttribute( "text_blue",
+                        QString::number(node->textColor().blue()));
+        nodes_root.appendChild(cn);
+    }
+
+    QDomElement edges_root = doc.createElement("edges");
+    root.appendChild(edges_root);
+    foreach(Node *node, nodeList)
+    {
+        foreach(Edge *edge, node->edgesFrom(false))
+        {
+            QDomElement cn = doc.createElement("edge");
+            cn.setAttribute( "source",
+                      QString::number(nodeList.indexOf(edge->sourceNode())));
+            cn.setAttribute( "destination",
+                      QString::number(nodeList.indexOf(edge->destNode())));
+            cn.setAttribute( "red", QString::number(edge->color().red()));
+            cn.setAttribute( "green", QString::number(edge->color().green()));
+            cn.setAttribute( "blue", QString::number(edge->color().blue()));
+            cn.setAttribute( "width", QString::number(edge->width()));
+            cn.setAttribute( "secondary", QString::number(edge->secondary()));
+            edges_root.appendChild(cn);
+        }
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+
+    QTextStream ts( &file );
+    ts << doc.toString();
+    file.close();
+}
+
+/** Reads a "VmXXX: 1234 kB" line of /proc/self/status,
+  * returns with -1 where it is not available.
+  */
+static qint64 procStatusKb(const QByteArray &key)
+{
+    QFile status("/proc/self/status");
+    if (!status.open(QIODevice::ReadOnly))
+        return -1;
+
+    foreach(QByteArray line, status.readAll().split('\n'))
+        if (line.startsWith(key))
+            return line.mid(key.size()).replace("kB", "").trimmed()
+                    .toLongLong();
+
+    return -1;
+}
+
+// Linux resets the peak RSS (VmHWM) to the current RSS on this request.
+static bool resetPeakRss()
+{
+    QFile clearRefs("/proc/self/clear_refs");
+    if (!clearRefs.open(QIODevice::WriteOnly))
+        return false;
+
+    return clearRefs.write("5") == 1;
+}
+
+FileBenchmarks::FileBenchmarks(QObject *parent)
+    : QObject(parent)
+    , m_mainWindow(0)
+    , m_graphWidget(0)
+    , m_graphLogic(0)
+    , m_loadWidget(0)
+{
+}
+
+void FileBenchmarks::initTestCase()
+{
+    m_mainWindow = new MainWindow;
+    m_graphWidget = new GraphWidget(m_mainWindow);
+    m_graphLogic = m_graphWidget->graphLogic();
+    m_loadWidget = new GraphWidget(m_mainWindow);
+    m_fileName = QDir::tempPath() + "/qtmindmap_benchmark.qmm";
+    m_binaryFileName = QDir::tempPath() + "/qtmindmap_benchmark.qmmb";
+
+    // a tree where every Node has four children, scattered on the scene
+    m_graphLogic->addFirstNode();
+    qsrand(42);
+    for (int i = 1; i < NodeCount; i++)
+    {
+        Node *node = m_graphLogic->nodeFactory();
+        m_graphWidget->scene()->addItem(node);
+        m_graphLogic->m_nodeList.append(node);
+        node->setHtml(QString("node %1").arg(i));
+        node->setPos(qrand() % 700 - 350, qrand() % 700 - 350);
+
+        Node *parent = m_graphLogic->m_nodeList[(i - 1) / 4];
+        Edge *edge = new Edge(parent, node);
+        parent->addEdge(edge, true);
+        node->addEdge(edge, false);
+        m_graphWidget->scene()->addItem(edge);
+    }
+}
+
+void FileBenchmarks::cleanupTestCase()
+{
+    m_graphLogic->removeAllNodes();
+    QFile::remove(m_fileName);
+    QFile::remove(m_binaryFileName);
+
+    delete m_mainWindow;
+}
+
+void FileBenchmarks::writeXmlStream()
+{
+    QBENCHMARK
+    {
+        m_graphLogic->writeContentToFile(m_fileName);
+    }
+}
+
+void FileBenchmarks::writeXmlDom()
+{
+    QBENCHMARK
+    {
+        writeWithDom(m_graphLogic->m_nodeList, m_fileName);
+    }
+}
+
+void FileBenchmarks::writeXmlPeakMemory()
+{
+    if (procStatusKb("VmHWM:") == -1 || !resetPeakRss())
+        QSKIP("Peak RSS can be measured on Linux only.", SkipAll);
+
+    qint64 before = procStatusKb("VmRSS:");
+    m_graphLogic->writeContentToFile(m_fileName);
+    qint64 stream = procStatusKb("VmHWM:") - before;
+
+    resetPeakRss();
+    before = procStatusKb("VmRSS:");
+    writeWithDom(m_graphLogic->m_nodeList, m_fileName);
+    qint64 dom = procStatusKb("VmHWM:") - before;
+
+    qDebug() << "peak RSS growth while saving" << NodeCount << "nodes:"
+             << "stream" << stream << "kB,"
+             << "DOM" << dom << "kB";
+
+    QVERIFY(stream < dom);
+}
+
+void FileBenchmarks::readXml()
+{
+    m_graphLogic->writeContentToFile(m_fileName);
+
+    QBENCHMARK
+    {
+        QVERIFY(m_loadWidget->graphLogic()->readContentFromFile(m_fileName));
+        m_loadWidget->graphLogic()->removeAllNodes();
+    }
+}
+
+void FileBenchmarks::readBinary()
+{
+    m_graphLogic->writeContentToFile(m_binaryFileName);
+
+    QBENCHMARK
+    {
+        QVERIFY(m_loadWidget->graphLogic()->readContentFromFile(
+                    m_binaryFileName));
+        m_loadWidget->graphLogic()->removeAllNodes();
+    }
+}
+
+void FileBenchmarks::loadInBackground()
+{
+    QEventLoop loop;
+    connect(m_loadWidget->graphLogic(), SIGNAL(loadFinished(const bool&)),
+            &loop, SLOT(quit()));
+
+    m_loadWidget->graphLogic()->readContentInBackground(m_fileName);
+    loop.exec();
+
+    QCOMPARE(m_loadWidget->graphLogic()->m_nodeList.size(), NodeCount);
+    m_loadWidget->graphLogic()->removeAllNodes();
+}
+
+// the node documents are laid out on every core
+void FileBenchmarks::readXmlInBackground()
+{
+    m_graphLogic->writeContentToFile(m_fileName);
+
+    QBENCHMARK
+    {
+        loadInBackground();
+    }
+}
+
+// the same on one core, the base of the scaling
+void FileBenchmarks::readXmlInBackgroundOneThread()
+{
+    m_graphLogic->writeContentToFile(m_fileName);
+
+    int threads = QThreadPool::globalInstance()->maxThreadCount();
+    QThreadPool::globalInstance()->setMaxThreadCount(1);
+
+    QBENCHMARK
+    {
+        loadInBackground();
+    }
+
+    QThreadPool::globalInstance()->setMaxThreadCount(threads);
+}
+
+// .qmm -> .qmmb -> .qmm has to give back the same file
+void FileBenchmarks::convertRoundTrip()
+{
+    QString roundTripFileName(QDir::tempPath() +
+                              "/qtmindmap_benchmark_roundtrip.qmm");
+
+    m_graphLogic->writeContentToFile(m_fileName);
+    QVERIFY(MapWriter::convert(m_fileName, m_binaryFileName));
+    QVERIFY(MapWriter::convert(m_binaryFileName, roundTripFileName));
+
+    QFile original(m_fileName);
+    QFile roundTrip(roundTripFileName);
+    QVERIFY(original.open(QIODevice::ReadOnly));
+    QVERIFY(roundTrip.open(QIODevice::ReadOnly));
+    QVERIFY(original.readAll() == roundTrip.readAll());
+
+    roundTrip.remove();
+}
+
+// the tiles are rendered on every core
+void FileBenchmarks::exportPng()
+{
+    QString pngFileName(QDir::tempPath() + "/qtmindmap_benchmark.png");
+
+    QBENCHMARK
+    {
+        m_graphLogic->writeContentToPngFile(pngFileName, 300);
+    }
+
+    QImage image(pngFileName);
+    QVERIFY(!image.isNull());
+    QFile::remove(pngFileName);
+}
+
+// the same on one core, the base of the scaling
+void FileBenchmarks::exportPngOneThread()
+{
+    QString pngFileName(QDir::tempPath() + "/qtmindmap_benchmark.png");
+
+    int threads = QThreadPool::globalInstance()->maxThreadCount();
+    QThreadPool::globalInstance()->setMaxThreadCount(1);
+
+    QBENCHMARK
+    {
+        m_graphLogic->writeContentToPngFile(pngFileName, 300);
+    }
+
+    QThreadPool::globalInstance()->setMaxThreadCount(threads);
+    QFile::remove(pngFileName);
+}
+
+// a base node with SubtreeSize descendants on a GraphWidget of its own
+void FileBenchmarks::buildSubtree()
+{
+    GraphLogic *graphLogic = m_loadWidget->graphLogic();
+    graphLogic->addFirstNode();
+    for (int i = 1; i <= SubtreeSize; i++)
+    {
+        Node *node = graphLogic->nodeFactory();
+        m_loadWidget->scene()->addItem(node);
+        graphLogic->m_nodeList.append(node);
+
+        Node *parent = graphLogic->m_nodeList[(i - 1) / 4];
+        Edge *edge = new Edge(parent, node);
+        parent->addEdge(edge, true);
+        node->addEdge(edge, false);
+        m_loadWidget->scene()->addItem(edge);
+    }
+}
+
+// what BaseUndoClass asks at every subtree command and drag step
+void FileBenchmarks::subtree()
+{
+    buildSubtree();
+    Node *base = m_loadWidget->graphLogic()->m_nodeList.first();
+
+    QBENCHMARK
+    {
+        QCOMPARE(base->subtree().size(), SubtreeSize + 1);
+    }
+
+    m_loadWidget->graphLogic()->removeAllNodes();
+}
+
+// the first query after a change of the tree walks the subtree
+void FileBenchmarks::subtreeAfterChange()
+{
+    buildSubtree();
+    GraphLogic *graphLogic = m_loadWidget->graphLogic();
+    Node *base = graphLogic->m_nodeList.first();
+
+    QBENCHMARK
+    {
+        graphLogic->subtreeIndex()->invalidate();
+        QCOMPARE(base->subtree().size(), SubtreeSize + 1);
+    }
+
+    graphLogic->removeAllNodes();
+}
+
+// the traversal through the child edges, the way without the index
+void FileBenchmarks::subtreeTraversal()
+{
+    buildSubtree();
+    Node *base = m_loadWidget->graphLogic()->m_nodeList.first();
+
+    QBENCHMARK
+    {
+        QCOMPARE(base->collectSubtree().size(), SubtreeSize + 1);
+    }
+
+    m_loadWidget->graphLogic()->removeAllNodes();
+}
+
+// every Node of the subtree asked against the base
+void FileBenchmarks::subtreeMembership()
+{
+    buildSubtree();
+    const QList<Node *> &nodes = m_loadWidget->graphLogic()->m_nodeList;
+    Node *base = nodes.first();
+
+    QBENCHMARK
+    {
+        int members = 0;
+        foreach(Node *node, nodes)
+            if (node->isInSubtreeOf(base))
+                members++;
+
+        QCOMPARE(members, SubtreeSize + 1);
+    }
+
+    m_loadWidget->graphLogic()->removeAllNodes();
+}
+
+// a drag step of the whole subtree, the edges are adjusted once per step
+void FileBenchmarks::dragSubtree()
+{
+    buildSubtree();
+    GraphLogic *graphLogic = m_loadWidget->graphLogic();
+    graphLogic->flushAdjusts();
+    Node *base = graphLogic->m_nodeList.first();
+
+    const quint64 requests = graphLogic->adjustRequests();
+    const quint64 runs = graphLogic->adjustRuns();
+    graphLogic->beginDrag(base, true);
+
+    qreal step = 1;
+    QBENCHMARK
+    {
+        graphLogic->drag(step, 0);
+        graphLogic->flushAdjusts();
+        step = -step;
+    }
+
+    graphLogic->endDrag();
+
+    // every edge is asked by both of its nodes
+    qDebug() << "Edge::adjust() asked"
+             << graphLogic->adjustRequests() - requests << "times, run"
+             << graphLogic->adjustRuns() - runs << "times";
+    QVERIFY(graphLogic->adjustRuns() - runs <
+            graphLogic->adjustRequests() - requests);
+
+    graphLogic->removeAllNodes();
+}
+
+/** A tree of items / 2 Nodes on m_loadWidget, spread over an area which
+  * grows with the map like a real one. The index is chosen by the policy
+  * of GraphLogic or turned off, to have the scene without an index as the
+  * baseline.
+  */
+void FileBenchmarks::buildScatteredMap(const int &items,
+                                       const bool &adaptiveIndex)
+{
+    GraphLogic *graphLogic = m_loadWidget->graphLogic();
+    const int side = 60 * int(sqrt(qreal(items / 2)));
+
+    graphLogic->addFirstNode();
+    qsrand(42);
+    for (int i = 1; i < items / 2; i++)
+    {
+        Node *node = graphLogic->nodeFactory();
+        m_loadWidget->scene()->addItem(node);
+        graphLogic->m_nodeList.append(node);
+        node->setPos(qrand() % side - side / 2, qrand() % side - side / 2);
+
+        Node *parent = graphLogic->m_nodeList[(i - 1) / 4];
+        Edge *edge = new Edge(parent, node);
+        parent->addEdge(edge, true);
+        node->addEdge(edge, false);
+        m_loadWidget->scene()->addItem(edge);
+    }
+
+    graphLogic->flushAdjusts();
+    if (adaptiveIndex)
+    {
+        graphLogic->updateItemIndex();
+    }
+    else
+    {
+        m_loadWidget->scene()->setItemIndexMethod(QGraphicsScene::NoIndex);
+    }
+}
+
+static void addIndexRows()
+{
+    QTest::addColumn<int>("items");
+    QTest::addColumn<bool>("adaptiveIndex");
+
+    QTest::newRow("1k items, no index") << 1000 << false;
+    QTest::newRow("1k items, adaptive") << 1000 << true;
+    QTest::newRow("10k items, no index") << 10000 << false;
+    QTest::newRow("10k items, adaptive") << 10000 << true;
+    QTest::newRow("100k items, no index") << 100000 << false;
+    QTest::newRow("100k items, adaptive") << 100000 << true;
+}
+
+void FileBenchmarks::viewportPaint_data()
+{
+    addIndexRows();
+}
+
+// a repaint of a window sized part of the map, around the base node
+void FileBenchmarks::viewportPaint()
+{
+    QFETCH(int, items);
+    QFETCH(bool, adaptiveIndex);
+    buildScatteredMap(items, adaptiveIndex);
+
+    QImage image(800, 600, QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&image);
+
+    QBENCHMARK
+    {
+        m_loadWidget->scene()->render(&painter, QRectF(),
+                                      QRectF(-400, -300, 800, 600));
+    }
+
+    painter.end();
+    m_loadWidget->graphLogic()->removeAllNodes();
+}
+
+void FileBenchmarks::clickItem_data()
+{
+    addIndexRows();
+}
+
+// what a mouse press asks the scene: the items under the cursor
+void FileBenchmarks::clickItem()
+{
+    QFETCH(int, items);
+    QFETCH(bool, adaptiveIndex);
+    buildScatteredMap(items, adaptiveIndex);
+
+    // the clicks hit Nodes, Edges and the paper as well
+    GraphLogic *graphLogic = m_loadWidget->graphLogic();
+    QList<QPointF> clicks;
+    for (int i = 0; i < 100; i++)
+        clicks.append(graphLogic->m_nodeList[i * 7 % (items / 2)]->pos() +
+                      QPointF(i % 5 * 10, i % 3 * 10));
+
+    QBENCHMARK
+    {
+        foreach(const QPointF &click, clicks)
+            m_loadWidget->scene()->items(click);
+    }
+
+    graphLogic->removeAllNodes();
+}
+
+void FileBenchmarks::wholeMapPaint_data()
+{
+    QTest::addColumn<bool>("levelOfDetail");
+
+    QTest::newRow("full detail") << false;
+    QTest::newRow("level of detail") << true;
+}
+
+/** The Nodes of the NodeCount map at a tenth of their size, the way a map
+  * of that many Nodes fits on the screen. The Nodes are painted one by
+  * one like the scene does, so the full detail can be forced.
+  */
+void FileBenchmarks::wholeMapPaint()
+{
+    QFETCH(bool, levelOfDetail);
+    const QList<Node *> &nodes = m_graphLogic->m_nodeList;
+
+    QImage image(800, 600, QImage::Format_ARGB32_Premultiplied);
+    QTransform view;
+    view.translate(400, 300);
+    view.scale(0.1, 0.1);
+
+    QBENCHMARK
+    {
+        QPainter painter(&image);
+        foreach(Node *node, nodes)
+        {
+            QStyleOptionGraphicsItem option;
+            option.exposedRect = node->boundingRect();
+
+            painter.save();
+            painter.setWorldTransform(node->sceneTransform() * view);
+            if (levelOfDetail)
+            {
+                static_cast<QGraphicsTextItem *>(node)->paint(&painter,
+                                                              &option, 0);
+            }
+            else
+            {
+                node->paintFull(&painter, &option, 0);
+            }
+            painter.restore();
+        }
+    }
+}
+
+void FileBenchmarks::edgePaint_data()
+{
+    QTest::addColumn<bool>("edgeLayer");
+
+    QTest::newRow("an item per edge") << false;
+    QTest::newRow("edge layer") << true;
+}
+
+// the NodeCount map with its Nodes hidden, so only the Edges are painted
+void FileBenchmarks::edgePaint()
+{
+    QFETCH(bool, edgeLayer);
+    m_graphLogic->setEdgeLayer(edgeLayer);
+    foreach(Node *node, m_graphLogic->m_nodeList)
+        node->hide();
+
+    QImage image(800, 800, QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    QBENCHMARK
+    {
+        m_graphWidget->scene()->render(&painter, QRectF(),
+                                       QRectF(-400, -400, 800, 800));
+    }
+
+    painter.end();
+    foreach(Node *node, m_graphLogic->m_nodeList)
+        node->show();
+
+    m_graphLogic->setEdgeLayer(false);
+}
+
+/** The memory ShadowNodeCount Nodes take and what the drop shadow effect
+  * every Node used to have adds to it
+  */
+void FileBenchmarks::nodeMemory()
+{
+    if (procStatusKb("VmRSS:") == -1)
+        QSKIP("RSS can be measured on Linux only.", SkipAll);
+
+    GraphLogic *graphLogic = m_loadWidget->graphLogic();
+    qint64 before = procStatusKb("VmRSS:");
+    for (int i = 0; i < ShadowNodeCount; i++)
+    {
+        Node *node = graphLogic->nodeFactory();
+        m_loadWidget->scene()->addItem(node);
+        graphLogic->m_nodeList.append(node);
+    }
+    const qint64 nodes = procStatusKb("VmRSS:") - before;
+
+    // the way the constructor of Node set it up
+    before = procStatusKb("VmRSS:");
+    foreach(Node *node, graphLogic->m_nodeList)
+    {
+        QGraphicsDropShadowEffect *effect =
+                new QGraphicsDropShadowEffect(node);
+        node->setGraphicsEffect(effect);
+        effect->setEnabled(false);
+        effect->setOffset(qreal(4.0));
+    }
+    const qint64 effects = procStatusKb("VmRSS:") - before;
+
+    qDebug() << "RSS growth by" << ShadowNodeCount << "nodes:"
+             << nodes << "kB, by their effects:" << effects << "kB,"
+             << effects * 1024 / ShadowNodeCount << "bytes per node";
+
+    graphLogic->removeAllNodes();
+}
+
+QTEST_MAIN(FileBenchmarks)
@@ -0,0 +1,62 @@
+#ifndef FILEBENCHMARKS_H
+#define FILEBENCHMARKS_H
+
+#include <QtTest/QtTest>
+
+class MainWindow;
+class GraphWidget;
+class GraphLogic;
+
+class FileBenchmarks : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileBenchmarks(QObject *parent = 0);
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void writeXmlStream();
+    void writeXmlDom();
+    void writeXmlPeakMemory();
+
+    void readXml();
+    void readBinary();
+    void readXmlInBackground();
+    void readXmlInBackgroundOneThread();
+    void convertRoundTrip();
+    void exportPng();
+    void exportPngOneThread();
+
+    void subtree();
+    void subtreeAfterChange();
+    void subtreeTraversal();
+    void subtreeMembership();
+    void dragSubtree();
+
+    void viewportPaint_data();
+    void viewportPaint();
+    void clickItem_data();
+    void clickItem();
+    void wholeMapPaint_data();
+    void wholeMapPaint();
+    void edgePaint_data();
+    void edgePaint();
+    void nodeMemory();
+
+private:
+    void loadInBackground();
+    void buildSubtree();
+    void buildScatteredMap(const int &items, const bool &adaptiveIndex);
+
+    MainWindow *m_mainWindow;
+    GraphWidget *m_graphWidget;
+    GraphLogic *m_graphLogic;
+    GraphWidget *m_loadWidget;
+    QString m_fileName;
+    QString m_binaryFileName;
+};
+
+#endif // FILEBENCHMARKS_H